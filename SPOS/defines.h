@@ -34,20 +34,51 @@
 //! The current id of the exercise (this must be changed every two weeks).
 #define VERSUCH 2
 
+//! Whether the heaps are built. They limit the number of processes to MAX_NUMBER_OF_HEAP_PROCESSES.
+#ifndef HEAP_SUPPORT
+#define HEAP_SUPPORT                1
+#endif
+
 //----------------------------------------------------------------------------
 // System constants
 //----------------------------------------------------------------------------
 
 /*!
  *  Maximum number of processes that can be running at the same time
- *  (may be nothing > 8).
+ *  (may be nothing > 32, or > MAX_NUMBER_OF_HEAP_PROCESSES while the heaps
+ *  are built).
  *  This number includes the idle proc, although it is considered a system proc.
  *  The idle proc. has always id 0. The highest ID is MAX_NUMBER_OF_PROCESSES-1.
+ *  Note that all processes share the memory for process stacks.
  */
+#ifndef MAX_NUMBER_OF_PROCESSES
 #define MAX_NUMBER_OF_PROCESSES     8
+#endif
 
-//! Maximum number of programs that can be known by the os (<17, 255 is invalid).
+//! Maximum number of programs that can be known by the os (<65, 255 is invalid).
+#ifndef MAX_NUMBER_OF_PROGRAMS
 #define MAX_NUMBER_OF_PROGRAMS      16
+#endif
+
+/*!
+ *  Maximum number of processes while the heaps are built. The heaps store the
+ *  owner of a chunk in a nibble of the map or of its tags, where the idle
+ *  process cannot own memory and 0xF marks continuation bytes in the map.
+ *  Builds that need more processes have to set HEAP_SUPPORT to 0.
+ */
+#define MAX_NUMBER_OF_HEAP_PROCESSES 15
+
+#if MAX_NUMBER_OF_PROCESSES < 1 || MAX_NUMBER_OF_PROCESSES > 32
+    #error MAX_NUMBER_OF_PROCESSES must be between 1 and 32
+#endif
+
+#if HEAP_SUPPORT && MAX_NUMBER_OF_PROCESSES > MAX_NUMBER_OF_HEAP_PROCESSES
+    #error MAX_NUMBER_OF_PROCESSES must be at most 15 while HEAP_SUPPORT is set, as the heaps store chunk owners in a nibble
+#endif
+
+#if MAX_NUMBER_OF_PROGRAMS < 1 || MAX_NUMBER_OF_PROGRAMS > 64
+    #error MAX_NUMBER_OF_PROGRAMS must be between 1 and 64
+#endif
 
 //! Standard priority for newly created processes
 #define DEFAULT_PRIORITY            2
@@ -67,6 +98,33 @@
 //! Number to specify an invalid program.
 #define INVALID_PROGRAM             255
 
+//! Number of jobs the deferred work queue can hold (power of two, at most 128)
+#define DEFERRED_WORK_QUEUE_SIZE    8
+
+//! Maximum number of deferred jobs that are run per scheduler call
+#define DEFERRED_WORK_BUDGET        4
+
+//! Maximum number of lightweight tasks that are run by one deferred runner job
+#define TASK_RUN_BUDGET             8
+
+//! Whether os_post is built. Its worker process takes a slot and POST_WORKER_STACK_SIZE bytes of stack
+#ifndef POST_SUPPORT
+#define POST_SUPPORT                0
+#endif
+
+//! Number of functions os_post can queue (power of two, at most 128)
+#define POST_QUEUE_SIZE             8
+
+//! Priority of the worker process that runs posted functions
+#ifndef POST_WORKER_PRIORITY
+#define POST_WORKER_PRIORITY        DEFAULT_PRIORITY
+#endif
+
+//! Stack size of the worker process that runs posted functions
+#ifndef POST_WORKER_STACK_SIZE
+#define POST_WORKER_STACK_SIZE      96
+#endif
+
 //----------------------------------------------------------------------------
 // Stack constants
 //----------------------------------------------------------------------------
@@ -77,8 +135,69 @@
 //! The scheduler's stack size
 #define STACK_SIZE_ISR              192
 
-//! The stack size of a process
-#define STACK_SIZE_PROC             (((AVR_MEMORY_SRAM / 2) - STACK_SIZE_MAIN - STACK_SIZE_ISR) / MAX_NUMBER_OF_PROCESSES)
+//! The size of the memory region all process stacks are allocated from
+#define STACK_SIZE_PROCS            ((AVR_MEMORY_SRAM / 2) - STACK_SIZE_MAIN - STACK_SIZE_ISR)
+
+//! The stack size of a process whose program does not specify one
+#ifndef STACK_SIZE_PROC
+#define STACK_SIZE_PROC             (STACK_SIZE_PROCS / MAX_NUMBER_OF_PROCESSES)
+#endif
+
+//! The smallest stack a program may request (initial context plus a few calls)
+#define STACK_SIZE_PROC_MIN         48
+
+//! The byte unused process stack memory is painted with, used to find the high-water mark
+#define STACK_PAINT_PATTERN         0xAA
+
+//! The guard value in the lowest bytes of every process stack, checked on every switch
+#define STACK_CANARY                0xC35A
+
+//! The number of bytes taken by STACK_CANARY
+#define STACK_CANARY_SIZE           2
+
+//----------------------------------------------------------------------------
+// Stack checksum settings
+//----------------------------------------------------------------------------
+
+//! Stack checksums are not checked by the scheduler
+#define STACK_CHECK_OFF             0
+
+//! The scheduler checksums the whole used stack at every switch-out and switch-in
+#define STACK_CHECK_FULL            1
+
+//! The scheduler only checksums the STACK_CHECK_WINDOW bytes above the saved stack pointer
+#define STACK_CHECK_INCREMENTAL     2
+
+/*!
+ *  How the scheduler protects the stacks of processes that are switched out.
+ *  The checksum is recorded together with the saved stack pointer when a
+ *  process is switched out and verified when it is switched in again.
+ *  In full mode the cost grows with the stack depth. In incremental mode only
+ *  the saved context (the frame that is restored first) and the return
+ *  address below it are covered, so the cost is fixed. Overflows into the
+ *  stack are still caught by the canary.
+ */
+#ifndef STACK_CHECK_MODE
+#define STACK_CHECK_MODE            STACK_CHECK_INCREMENTAL
+#endif
+
+//! Number of bytes above the saved stack pointer covered in incremental mode (context, SREG and return address)
+#define STACK_CHECK_WINDOW          35
+
+//! XOR of all bytes. Estimated ~7 cycles per byte, about 250 cycles for the incremental window.
+#define STACK_CHECKSUM_XOR          0
+
+//! 8-bit Fletcher checksum (two ones' complement sums). Detects swapped bytes as well. Estimated ~12 cycles per byte, about 420 cycles for the incremental window.
+#define STACK_CHECKSUM_FLETCHER     1
+
+//! The algorithm used for stack checksums
+#ifndef STACK_CHECKSUM_ALGORITHM
+#define STACK_CHECKSUM_ALGORITHM    STACK_CHECKSUM_XOR
+#endif
+
+#if STACK_SIZE_PROC < STACK_SIZE_PROC_MIN
+    #error STACK_SIZE_PROC is too small, lower MAX_NUMBER_OF_PROCESSES or give the programs explicit stack sizes
+#endif
 
 //! The bottom of the main stack. That is the highest address.
 #define BOTTOM_OF_MAIN_STACK        (AVR_SRAM_LAST)
@@ -89,7 +208,7 @@
 //! The bottom of the memory chunks for all process stacks. That is the highest address.
 #define BOTTOM_OF_PROCS_STACK       (BOTTOM_OF_ISR_STACK - STACK_SIZE_ISR)
 
-//! The bottom of the memory chunk with number PID.
-#define PROCESS_STACK_BOTTOM(PID)   (BOTTOM_OF_PROCS_STACK - ((PID) * STACK_SIZE_PROC))
+//! The top of the memory chunks for all process stacks. That is the lowest address.
+#define TOP_OF_PROCS_STACK          (BOTTOM_OF_PROCS_STACK - STACK_SIZE_PROCS + 1)
 
 #endif
@@ -0,0 +1,100 @@
+#include "os_arena.h"
+#include "os_memory.h"
+#include "os_core.h"
+
+/*! \file
+ *
+ * Bump allocators on top of the heaps. Allocating from an arena reads two
+ * words and writes one, independent of the allocation strategy and the
+ * layout of the heap. Nothing is tracked per allocation, hence single
+ * allocations cannot be freed, only the whole arena.
+ *
+ */
+
+//! Offset of the address of the next free byte in the arena header
+#define MEM_ARENA_TOP       0
+
+//! Offset of the address behind the arena in the arena header
+#define MEM_ARENA_END       2
+
+/*!
+ *  Creates an arena for the current process. The backing chunk is owned by
+ *  the current process and is freed when it terminates, even if the arena is
+ *  never destroyed.
+ *
+ *  \param heap The heap to take the chunk from.
+ *  \param size The number of bytes the arena can hand out.
+ *  \return The address of the arena or 0 if the heap has no room for it.
+ */
+MemAddr os_arenaCreate(Heap* heap, uint16_t size) {
+    if (!size || size > UINT16_MAX - MEM_ARENA_HEADER) {
+        return 0;
+    }
+
+    MemAddr const arena = os_malloc(heap, size + MEM_ARENA_HEADER);
+    if (arena) {
+        os_writeHeapWord(heap, arena + MEM_ARENA_END, arena + MEM_ARENA_HEADER + size);
+        os_arenaReset(heap, arena);
+    }
+    return arena;
+}
+
+/*!
+ *  Allocates bytes from an arena. The memory is not initialized and stays
+ *  valid until the arena is reset or destroyed.
+ *
+ *  \param heap The heap of the arena.
+ *  \param arena The arena to allocate from.
+ *  \param size The number of bytes to allocate.
+ *  \return The address of the bytes or 0 if the arena has not enough room left.
+ */
+MemAddr os_arenaAlloc(Heap const* heap, MemAddr arena, uint16_t size) {
+    MemAddr const top = os_readHeapWord(heap, arena + MEM_ARENA_TOP);
+    MemAddr const end = os_readHeapWord(heap, arena + MEM_ARENA_END);
+
+    if (top > end) {
+        os_error("Ungueltige Arena");
+        return 0;
+    }
+    if (!size || size > end - top) {
+        return 0;
+    }
+
+    os_writeHeapWord(heap, arena + MEM_ARENA_TOP, top + size);
+    return top;
+}
+
+/*!
+ *  Frees everything that was allocated from an arena. The arena itself stays
+ *  usable.
+ *
+ *  \param heap The heap of the arena.
+ *  \param arena The arena to reset.
+ */
+void os_arenaReset(Heap const* heap, MemAddr arena) {
+    os_writeHeapWord(heap, arena + MEM_ARENA_TOP, arena + MEM_ARENA_HEADER);
+}
+
+/*!
+ *  Frees an arena. All memory allocated from it becomes invalid. Only the
+ *  process that created the arena may destroy it.
+ *
+ *  \param heap The heap of the arena.
+ *  \param arena The arena to destroy.
+ */
+void os_arenaDestroy(Heap* heap, MemAddr arena) {
+    os_free(heap, arena);
+}
+
+/*!
+ *  Returns the number of bytes that can still be allocated from an arena.
+ *
+ *  \param heap The heap of the arena.
+ *  \param arena The arena to examine.
+ *  \return The number of free bytes of the arena.
+ */
+uint16_t os_arenaAvailable(Heap const* heap, MemAddr arena) {
+    MemAddr const top = os_readHeapWord(heap, arena + MEM_ARENA_TOP);
+    MemAddr const end = os_readHeapWord(heap, arena + MEM_ARENA_END);
+    return (top <= end) ? end - top : 0;
+}
@@ -0,0 +1,48 @@
+/*! \file
+ *  \brief Arenas for short-lived heap memory.
+ *
+ *  Contains bump allocators that carve many small allocations out of a single
+ *  heap chunk. They are not freed one by one but all at once, which makes
+ *  allocating nearly free of cost.
+ */
+
+#ifndef _OS_ARENA_H
+#define _OS_ARENA_H
+
+#include <stdint.h>
+
+#include "os_mem_drivers.h"
+#include "os_memheap_drivers.h"
+
+/*
+ * An arena is a chunk of a heap and is identified by the address os_malloc
+ * returned for it. Its first bytes hold the address of the next free byte and
+ * the address behind the chunk, the remaining bytes are handed out in order.
+ * The chunk is owned by the process that created the arena, so it is
+ * reclaimed together with all other memory of that process. An arena must
+ * only be used by one process at a time.
+ */
+
+//! Number of bytes at the start of an arena used for its state
+#define MEM_ARENA_HEADER    4
+
+//----------------------------------------------------------------------------
+// Function headers
+//----------------------------------------------------------------------------
+
+//! Creates an arena with room for the passed number of bytes, returns 0 on failure
+MemAddr os_arenaCreate(Heap* heap, uint16_t size);
+
+//! Allocates bytes from an arena, returns 0 if it is exhausted
+MemAddr os_arenaAlloc(Heap const* heap, MemAddr arena, uint16_t size);
+
+//! Frees everything allocated from an arena at once
+void os_arenaReset(Heap const* heap, MemAddr arena);
+
+//! Frees an arena and its chunk
+void os_arenaDestroy(Heap* heap, MemAddr arena);
+
+//! Returns the number of bytes that can still be allocated from an arena
+uint16_t os_arenaAvailable(Heap const* heap, MemAddr arena);
+
+#endif
@@ -0,0 +1,82 @@
+/*! \file
+ *  \brief Bitmaps for sets of processes and programs.
+ *
+ *  Contains macros to declare and access bitmaps of arbitrary length, so
+ *  tables indexed by process or program id are not limited to the width of a
+ *  single integer. Everything is sized at compile time.
+ */
+
+#ifndef _OS_BITMAP_H
+#define _OS_BITMAP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//----------------------------------------------------------------------------
+// Macros
+//----------------------------------------------------------------------------
+
+//! Number of bytes needed for a bitmap with BITS entries
+#define BITMAP_BYTES(BITS) (((BITS) + 7) / 8)
+
+/*!
+ *  Declares a bitmap with the given name that can hold BITS entries.
+ *  Use this macro in this fashion:
+ *
+ *    BITMAP(os_usedProcesses, MAX_NUMBER_OF_PROCESSES);
+ *    ...
+ *    BITMAP_SET(os_usedProcesses, pid);
+ */
+#define BITMAP(NAME, BITS) uint8_t NAME[BITMAP_BYTES(BITS)]
+
+//! Checks whether entry BIT of bitmap MAP is set
+#define BITMAP_TEST(MAP, BIT) (((MAP)[(BIT) / 8] >> ((BIT) % 8)) & 1)
+
+//! Sets entry BIT of bitmap MAP
+#define BITMAP_SET(MAP, BIT) ((MAP)[(BIT) / 8] |= (uint8_t)(1 << ((BIT) % 8)))
+
+//! Clears entry BIT of bitmap MAP
+#define BITMAP_CLEAR(MAP, BIT) ((MAP)[(BIT) / 8] &= (uint8_t)~(1 << ((BIT) % 8)))
+
+//----------------------------------------------------------------------------
+// Function headers
+//----------------------------------------------------------------------------
+
+/*!
+ *  Counts the set entries of a bitmap.
+ *
+ *  \param map The bitmap to examine.
+ *  \param bytes The size of the bitmap in bytes (see BITMAP_BYTES).
+ *  \return The number of set entries.
+ */
+static inline uint8_t os_bitmapCount(uint8_t const* map, uint8_t bytes) {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < bytes; i++) {
+        for (uint8_t byte = map[i]; byte; byte &= byte - 1) {
+            count++;
+        }
+    }
+    return count;
+}
+
+/*!
+ *  Finds the first cleared entry of a bitmap. Full bytes are skipped at once.
+ *
+ *  \param map The bitmap to examine.
+ *  \param bits The number of entries of the bitmap.
+ *  \return The index of the first cleared entry or bits if all are set.
+ */
+static inline uint8_t os_bitmapFirstClear(uint8_t const* map, uint8_t bits) {
+    for (uint8_t i = 0; i < BITMAP_BYTES(bits); i++) {
+        if (map[i] != 0xFF) {
+            uint8_t bit = i * 8;
+            for (uint8_t byte = map[i]; byte & 1; byte >>= 1) {
+                bit++;
+            }
+            return (bit < bits) ? bit : bits;
+        }
+    }
+    return bits;
+}
+
+#endif
@@ -3,6 +3,9 @@
 #include "util.h"
 #include "lcd.h"
 #include "os_input.h"
+#if HEAP_SUPPORT
+    #include "os_memory.h"
+#endif
 
 #include <avr/interrupt.h>
 #include <avr/wdt.h> 
@@ -120,6 +123,11 @@ void os_init(void) {
     os_checkResetSource(_BV(JTRF) | _BV(BORF) | _BV(EXTRF) | _BV(PORF));
     delayMs(DEFAULT_OUTPUT_DELAY * 20);
 
+#if HEAP_SUPPORT
+    initMemoryDevices();
+    os_initHeaps();
+#endif
+
     os_initScheduler();
 
     os_systemTime_reset();
@@ -146,7 +154,7 @@ void os_errorPStr(char const* str) {
 	    os_waitForInput();
     }
     //warte bis alle Tasten wieder losgelassen wurden
-    os_waitForNoInput()
+    os_waitForNoInput();
     
 	//stelle GIEB wieder her
 	SREG |= GlobalInterruptEnableBit;
@@ -0,0 +1,93 @@
+#include "os_deferred.h"
+#include "util.h"
+
+#include <avr/interrupt.h>
+
+/*! \file
+ *
+ * Deferred work queue. An ISR that has more to do than acknowledging its
+ * hardware enqueues a job with os_deferWork and returns. The scheduler runs
+ * the jobs on its own stack (BOTTOM_OF_ISR_STACK) with interrupts enabled,
+ * before it picks the next process. At most DEFERRED_WORK_BUDGET jobs are
+ * run per scheduler call, the rest is left for the next one.
+ *
+ * The queue uses free running 8-bit counters like os_ringbuffer. Producers
+ * only mask interrupts for the few cycles needed to claim a slot, so jobs may
+ * also be enqueued by processes and by other jobs. The scheduler is the only
+ * consumer and never masks interrupts while reading.
+ *
+ */
+
+#if (DEFERRED_WORK_QUEUE_SIZE & (DEFERRED_WORK_QUEUE_SIZE - 1)) || (DEFERRED_WORK_QUEUE_SIZE > 128)
+    #error "DEFERRED_WORK_QUEUE_SIZE must be a power of two up to 128"
+#endif
+
+//! A queued job.
+typedef struct {
+    DeferredWork* work;
+    void* arg;
+} DeferredWorkEntry;
+
+//! The queued jobs.
+static DeferredWorkEntry os_deferredWork[DEFERRED_WORK_QUEUE_SIZE];
+
+//! Number of jobs ever enqueued (modulo 256). Only changed by producers.
+static uint8_t volatile os_deferredWorkHead;
+
+//! Number of jobs ever run (modulo 256). Only changed by the scheduler.
+static uint8_t volatile os_deferredWorkTail;
+
+/*!
+ *  Enqueues a job that is run by the scheduler on its own stack. The job must
+ *  be short and must not block. os_getCurrentProc() still names the
+ *  interrupted process; killing or suspending it only marks it, as the
+ *  scheduler picks the next process after the jobs anyway. This function may
+ *  be called from ISRs, processes and other jobs.
+ *
+ *  \param work The function to run.
+ *  \param arg The argument that is passed to the function.
+ *  \return True if the job was enqueued, false if the queue was full.
+ */
+bool os_deferWork(DeferredWork* work, void* arg) {
+    uint8_t const sreg = SREG;
+    cli();
+
+    uint8_t const head = os_deferredWorkHead;
+    bool const space = (uint8_t)(head - os_deferredWorkTail) < DEFERRED_WORK_QUEUE_SIZE;
+    if (space) {
+        os_deferredWork[head & (DEFERRED_WORK_QUEUE_SIZE - 1)].work = work;
+        os_deferredWork[head & (DEFERRED_WORK_QUEUE_SIZE - 1)].arg = arg;
+        os_deferredWorkHead = head + 1;
+    }
+
+    SREG = sreg;
+    return space;
+}
+
+/*!
+ *  Runs up to DEFERRED_WORK_BUDGET queued jobs. This is called by the
+ *  scheduler ISR on the ISR stack with interrupts disabled. While the jobs
+ *  run, interrupts are enabled but the scheduler interrupt itself is masked,
+ *  so it cannot reenter. A tick that occurs meanwhile stays pending and is
+ *  served right afterwards.
+ */
+void os_runDeferredWork(void) {
+    uint8_t tail = os_deferredWorkTail;
+    if (os_deferredWorkHead == tail) {
+        return;
+    }
+
+    cbi(TIMSK2, OCIE2A);
+    sei();
+
+    uint8_t budget = DEFERRED_WORK_BUDGET;
+    while (budget-- && os_deferredWorkHead != tail) {
+        DeferredWorkEntry const entry = os_deferredWork[tail & (DEFERRED_WORK_QUEUE_SIZE - 1)];
+        __asm__ volatile("" ::: "memory");
+        os_deferredWorkTail = ++tail;
+        entry.work(entry.arg);
+    }
+
+    cli();
+    sbi(TIMSK2, OCIE2A);
+}
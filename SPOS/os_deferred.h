@@ -0,0 +1,33 @@
+/*! \file
+ *  \brief Deferred work (bottom halves) for the OS.
+ *
+ *  Contains a queue of small jobs that ISRs hand to the scheduler. The jobs
+ *  are run on the scheduler's stack right before the next process is chosen.
+ */
+
+#ifndef _OS_DEFERRED_H
+#define _OS_DEFERRED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "defines.h"
+
+//----------------------------------------------------------------------------
+// Types
+//----------------------------------------------------------------------------
+
+//! This is the type of a deferred job (not the pointer to one!).
+typedef void (DeferredWork)(void* arg);
+
+//----------------------------------------------------------------------------
+// Function headers
+//----------------------------------------------------------------------------
+
+//! Enqueues a job to be run by the scheduler (callable from ISRs)
+bool os_deferWork(DeferredWork* work, void* arg);
+
+//! Runs pending jobs, at most DEFERRED_WORK_BUDGET of them (scheduler only)
+void os_runDeferredWork(void);
+
+#endif
@@ -0,0 +1,307 @@
+#include "os_mem_drivers.h"
+#include "os_spi.h"
+#include "os_scheduler.h"
+
+#include <string.h>
+
+/*! \file
+ *
+ * Drivers for all memory devices. Each driver provides byte-wise and block
+ * access to its device through the MemDriver interface. The external SRAM is
+ * reached over SPI, where every transfer costs a command and an address on
+ * top of the data. Hence, its pages are kept in a small direct-mapped
+ * write-back cache in the internal SRAM, so the nibbles and words the heap
+ * accesses one by one mostly hit the cache. Blocks are transferred in one go
+ * for all pages that are not cached.
+ *
+ */
+
+/*!
+ *  The internal SRAM needs no initialization.
+ */
+static void os_intSRAMInit(void) {
+}
+
+/*!
+ *  Reads a byte from the internal SRAM.
+ *
+ *  \param addr The address to read from.
+ *  \return The byte at the passed address.
+ */
+static MemValue os_intSRAMRead(MemAddr addr) {
+    return *(MemValue volatile*)addr;
+}
+
+/*!
+ *  Writes a byte to the internal SRAM.
+ *
+ *  \param addr The address to write to.
+ *  \param value The byte to write.
+ */
+static void os_intSRAMWrite(MemAddr addr, MemValue value) {
+    *(MemValue volatile*)addr = value;
+}
+
+/*!
+ *  Reads a block from the internal SRAM.
+ *
+ *  \param addr The first address to read from.
+ *  \param buffer Where the bytes are stored.
+ *  \param length The number of bytes.
+ */
+static void os_intSRAMReadBlock(MemAddr addr, MemValue* buffer, uint16_t length) {
+    memcpy(buffer, (void const*)addr, length);
+}
+
+/*!
+ *  Writes a block to the internal SRAM.
+ *
+ *  \param addr The first address to write to.
+ *  \param buffer The bytes to write.
+ *  \param length The number of bytes.
+ */
+static void os_intSRAMWriteBlock(MemAddr addr, MemValue const* buffer, uint16_t length) {
+    memcpy((void*)addr, buffer, length);
+}
+
+//! The driver for the internal SRAM
+MemDriver intSRAM__ = {
+    .start = AVR_SRAM_START,
+    .size = AVR_MEMORY_SRAM,
+    .init = os_intSRAMInit,
+    .read = os_intSRAMRead,
+    .write = os_intSRAMWrite,
+    .readBlock = os_intSRAMReadBlock,
+    .writeBlock = os_intSRAMWriteBlock
+};
+
+#if EXTERNAL_SRAM
+
+//! A page of the external SRAM held in the cache
+typedef struct {
+    //! The first address of the page
+    MemAddr page;
+
+    //! Whether the line holds a page
+    bool valid;
+
+    //! Whether the line was written since it was loaded
+    bool dirty;
+
+    //! The contents of the page
+    MemValue data[EXT_SRAM_PAGE_SIZE];
+} ExtSRAMLine;
+
+//! The cache of the external SRAM, a page can only reside in one line
+static ExtSRAMLine os_extSRAMCache[EXT_SRAM_CACHE_LINES];
+
+//! The first address of the page containing the passed address
+#define os_extSRAMPage(ADDR) ((MemAddr)((ADDR) & ~(MemAddr)(EXT_SRAM_PAGE_SIZE - 1)))
+
+//! The cache line the page containing the passed address is loaded into
+#define os_extSRAMLine(ADDR) (&os_extSRAMCache[((ADDR) / EXT_SRAM_PAGE_SIZE) % EXT_SRAM_CACHE_LINES])
+
+/*!
+ *  Starts a transfer from or to the external SRAM. The transfer continues
+ *  across pages and runs in the background, see os_spiTransfer.
+ *
+ *  \param command EXT_SRAM_CMD_READ or EXT_SRAM_CMD_WRITE.
+ *  \param addr The first address.
+ *  \param tx The bytes to write or NULL.
+ *  \param rx Where the read bytes are stored or NULL.
+ *  \param length The number of bytes.
+ */
+static void os_extSRAMTransfer(uint8_t command, MemAddr addr, MemValue const* tx, MemValue* rx, uint16_t length) {
+    uint8_t const header[] = {command, 0, addr >> 8, addr & 0xFF};
+    os_spiTransfer(header, sizeof(header), tx, rx, length);
+}
+
+/*!
+ *  Returns the cache line holding the page of the passed address, if any.
+ *
+ *  \param addr An address of the external SRAM.
+ *  \return The line or NULL if the page is not cached.
+ */
+static ExtSRAMLine* os_extSRAMLookup(MemAddr addr) {
+    ExtSRAMLine* const line = os_extSRAMLine(addr);
+    return (line->valid && line->page == os_extSRAMPage(addr)) ? line : NULL;
+}
+
+/*!
+ *  Returns the cache line holding the page of the passed address. On a miss
+ *  the page in the line is written back if it is dirty and the page is
+ *  loaded. Must be called within a critical section.
+ *
+ *  \param addr An address of the external SRAM.
+ *  \return The line holding the page.
+ */
+static ExtSRAMLine* os_extSRAMFetch(MemAddr addr) {
+    ExtSRAMLine* const line = os_extSRAMLine(addr);
+    MemAddr const page = os_extSRAMPage(addr);
+
+    if (!line->valid || line->page != page) {
+        if (line->valid && line->dirty) {
+            os_extSRAMTransfer(EXT_SRAM_CMD_WRITE, line->page, line->data, NULL, EXT_SRAM_PAGE_SIZE);
+        }
+        // Starting the load waits for the write back, so the data is not overwritten early
+        os_extSRAMTransfer(EXT_SRAM_CMD_READ, page, NULL, line->data, EXT_SRAM_PAGE_SIZE);
+        os_spiWait();
+        line->page = page;
+        line->valid = true;
+        line->dirty = false;
+    }
+    return line;
+}
+
+/*!
+ *  Returns the number of bytes from the passed address up to the end of its
+ *  page, at most length.
+ *
+ *  \param addr An address of the external SRAM.
+ *  \param length The number of bytes left.
+ *  \return The number of bytes of the page.
+ */
+static uint16_t os_extSRAMPart(MemAddr addr, uint16_t length) {
+    uint16_t const part = EXT_SRAM_PAGE_SIZE - (addr % EXT_SRAM_PAGE_SIZE);
+    return (part < length) ? part : length;
+}
+
+/*!
+ *  Returns the number of bytes from the passed address on that lie in pages
+ *  which are not cached, at most length.
+ *
+ *  \param addr An address of the external SRAM whose page is not cached.
+ *  \param length The number of bytes left.
+ *  \return The number of bytes that can be transferred at once.
+ */
+static uint16_t os_extSRAMUncached(MemAddr addr, uint16_t length) {
+    uint16_t run = os_extSRAMPart(addr, length);
+    while (run < length && !os_extSRAMLookup(addr + run)) {
+        run += os_extSRAMPart(addr + run, length - run);
+    }
+    return run;
+}
+
+/*!
+ *  Selects sequential mode and empties the cache. The SPI has to be
+ *  initialized before.
+ */
+static void os_extSRAMInit(void) {
+    uint8_t const header[] = {EXT_SRAM_CMD_WRMR, EXT_SRAM_MODE_SEQUENTIAL};
+    os_spiTransfer(header, sizeof(header), NULL, NULL, 0);
+    os_spiWait();
+    for (uint8_t i = 0; i < EXT_SRAM_CACHE_LINES; i++) {
+        os_extSRAMCache[i].valid = false;
+    }
+}
+
+/*!
+ *  Reads a byte from the external SRAM through the cache.
+ *
+ *  \param addr The address to read from.
+ *  \return The byte at the passed address.
+ */
+static MemValue os_extSRAMRead(MemAddr addr) {
+    os_enterCriticalSection();
+    MemValue const value = os_extSRAMFetch(addr)->data[addr % EXT_SRAM_PAGE_SIZE];
+    os_leaveCriticalSection();
+    return value;
+}
+
+/*!
+ *  Writes a byte to the external SRAM through the cache. The page is written
+ *  back when it is evicted.
+ *
+ *  \param addr The address to write to.
+ *  \param value The byte to write.
+ */
+static void os_extSRAMWrite(MemAddr addr, MemValue value) {
+    os_enterCriticalSection();
+    ExtSRAMLine* const line = os_extSRAMFetch(addr);
+    line->data[addr % EXT_SRAM_PAGE_SIZE] = value;
+    line->dirty = true;
+    os_leaveCriticalSection();
+}
+
+/*!
+ *  Reads a block from the external SRAM. Cached pages are copied from the
+ *  cache, all others are read directly without being loaded into the cache.
+ *
+ *  \param addr The first address to read from.
+ *  \param buffer Where the bytes are stored.
+ *  \param length The number of bytes.
+ */
+static void os_extSRAMReadBlock(MemAddr addr, MemValue* buffer, uint16_t length) {
+    os_enterCriticalSection();
+    while (length) {
+        ExtSRAMLine const* const line = os_extSRAMLookup(addr);
+        uint16_t part;
+        if (line) {
+            part = os_extSRAMPart(addr, length);
+            memcpy(buffer, &line->data[addr % EXT_SRAM_PAGE_SIZE], part);
+        } else {
+            part = os_extSRAMUncached(addr, length);
+            os_extSRAMTransfer(EXT_SRAM_CMD_READ, addr, NULL, buffer, part);
+        }
+        addr += part;
+        buffer += part;
+        length -= part;
+    }
+    os_spiWait();
+    os_leaveCriticalSection();
+}
+
+/*!
+ *  Writes a block to the external SRAM. Cached pages are updated in the
+ *  cache, all others are written directly without being loaded into the
+ *  cache.
+ *
+ *  \param addr The first address to write to.
+ *  \param buffer The bytes to write.
+ *  \param length The number of bytes.
+ */
+static void os_extSRAMWriteBlock(MemAddr addr, MemValue const* buffer, uint16_t length) {
+    os_enterCriticalSection();
+    while (length) {
+        ExtSRAMLine* const line = os_extSRAMLookup(addr);
+        uint16_t part;
+        if (line) {
+            part = os_extSRAMPart(addr, length);
+            memcpy(&line->data[addr % EXT_SRAM_PAGE_SIZE], buffer, part);
+            line->dirty = true;
+        } else {
+            part = os_extSRAMUncached(addr, length);
+            os_extSRAMTransfer(EXT_SRAM_CMD_WRITE, addr, buffer, NULL, part);
+        }
+        addr += part;
+        buffer += part;
+        length -= part;
+    }
+    os_spiWait();
+    os_leaveCriticalSection();
+}
+
+//! The driver for the external SRAM
+MemDriver extSRAM__ = {
+    .start = 0,
+    .size = EXT_SRAM_SIZE,
+    .init = os_extSRAMInit,
+    .read = os_extSRAMRead,
+    .write = os_extSRAMWrite,
+    .readBlock = os_extSRAMReadBlock,
+    .writeBlock = os_extSRAMWriteBlock
+};
+
+#endif
+
+/*!
+ *  Initializes all memory devices. This has to be done before any heap is
+ *  used.
+ */
+void initMemoryDevices(void) {
+    intSRAM->init();
+#if EXTERNAL_SRAM
+    os_spiInit();
+    extSRAM->init();
+#endif
+}
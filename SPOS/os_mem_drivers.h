@@ -0,0 +1,106 @@
+/*! \file
+ *  \brief Drivers for the memory devices heaps can be placed on.
+ *
+ *  Contains the driver abstraction every heap accesses its memory through,
+ *  so the heap code does not depend on the kind of memory it manages.
+ */
+
+#ifndef _OS_MEM_DRIVERS_H
+#define _OS_MEM_DRIVERS_H
+
+#include <stdint.h>
+
+#include "defines.h"
+
+//----------------------------------------------------------------------------
+// Types
+//----------------------------------------------------------------------------
+
+//! An address on a memory device
+typedef uint16_t MemAddr;
+
+//! The value of a single memory cell
+typedef uint8_t MemValue;
+
+//! The interface of a memory device
+typedef struct {
+    //! The first valid address of the device
+    MemAddr start;
+
+    //! The number of bytes of the device
+    uint16_t size;
+
+    //! Readies the device for use
+    void (*init)(void);
+
+    //! Reads the byte at the passed address
+    MemValue (*read)(MemAddr addr);
+
+    //! Writes the passed byte to the passed address
+    void (*write)(MemAddr addr, MemValue value);
+
+    //! Reads length bytes starting at the passed address into the buffer
+    void (*readBlock)(MemAddr addr, MemValue* buffer, uint16_t length);
+
+    //! Writes length bytes from the buffer starting at the passed address
+    void (*writeBlock)(MemAddr addr, MemValue const* buffer, uint16_t length);
+} MemDriver;
+
+//----------------------------------------------------------------------------
+// External SRAM
+//----------------------------------------------------------------------------
+
+//! Whether an external SPI SRAM (23LC1024) is attached and gets a heap. Off by default, as the driver cannot tell whether the device is present.
+#ifndef EXTERNAL_SRAM
+#define EXTERNAL_SRAM                   0
+#endif
+
+//! The bytes of the external SRAM that are used. Addresses are 16 bit, so only the first 64 KiB are reachable.
+#define EXT_SRAM_SIZE                   0xFFFF
+
+//! Size of a page of the external SRAM, the unit the cache loads and writes back
+#define EXT_SRAM_PAGE_SIZE              32
+
+//! Number of pages the cache in the internal SRAM holds (a power of two)
+#ifndef EXT_SRAM_CACHE_LINES
+#define EXT_SRAM_CACHE_LINES            4
+#endif
+
+//! Command to read from the external SRAM
+#define EXT_SRAM_CMD_READ               0x03
+
+//! Command to write to the external SRAM
+#define EXT_SRAM_CMD_WRITE              0x02
+
+//! Command to set the mode of the external SRAM
+#define EXT_SRAM_CMD_WRMR               0x01
+
+//! Mode in which a transfer continues across pages
+#define EXT_SRAM_MODE_SEQUENTIAL        0x40
+
+//----------------------------------------------------------------------------
+// Globals
+//----------------------------------------------------------------------------
+
+//! The driver for the internal SRAM of the microcontroller
+extern MemDriver intSRAM__;
+
+//! Handy define to pass the internal SRAM driver
+#define intSRAM (&intSRAM__)
+
+#if EXTERNAL_SRAM
+//! The driver for the external SPI SRAM
+extern MemDriver extSRAM__;
+
+//! Handy define to pass the external SRAM driver
+#define extSRAM (&extSRAM__)
+#endif
+
+//----------------------------------------------------------------------------
+// Function headers
+//----------------------------------------------------------------------------
+
+//! Initializes all memory devices
+void initMemoryDevices(void);
+
+#endif
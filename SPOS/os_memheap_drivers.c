@@ -0,0 +1,119 @@
+#include "os_memheap_drivers.h"
+#include "os_memory_strategies.h"
+#include "os_core.h"
+
+#include <avr/pgmspace.h>
+
+/*! \file
+ *
+ * The heaps of the system. The internal heap takes the SRAM between the end
+ * of the global variables and the process stacks. Its exact bounds are only
+ * known at link time, so they are set by os_initHeaps. The external heap
+ * takes the reachable part of the external SRAM.
+ *
+ */
+
+//! The end of the global variables, provided by the linker
+extern char __heap_start;
+
+//! Name of the internal heap
+static char const intHeapName[] PROGMEM = "internal";
+
+//! The heap in the internal SRAM
+Heap intHeap__ = {
+    .driver = intSRAM,
+    .layout = INTERNAL_HEAP_LAYOUT,
+    .strategy = OS_MEM_FIRST,
+    .name = intHeapName
+};
+
+#if EXTERNAL_SRAM
+//! Name of the external heap
+static char const extHeapName[] PROGMEM = "external";
+
+//! The heap in the external SRAM
+Heap extHeap__ = {
+    .driver = extSRAM,
+    .layout = EXTERNAL_HEAP_LAYOUT,
+    .strategy = OS_MEM_FIRST,
+    .name = extHeapName
+};
+#endif
+
+//! All heaps, in the order the task manager lists them
+static Heap* const os_heaps[] = {
+    intHeap,
+#if EXTERNAL_SRAM
+    extHeap,
+#endif
+};
+
+/*!
+ *  Splits the memory of a heap into map and use area. The map gets one third
+ *  of the memory, any rest is left unused. In the tag layout all memory up to
+ *  MEM_TAG_SIZE_MAX bytes is use area.
+ *
+ *  \param heap The heap to set up.
+ *  \param start The first address of the heap's memory.
+ *  \param size The size of the heap's memory in bytes.
+ */
+static void os_initHeap(Heap* heap, MemAddr start, uint16_t size) {
+    if (heap->layout == OS_MEM_LAYOUT_TAGS) {
+        heap->mapStart = start;
+        heap->mapSize = 0;
+        heap->useStart = start;
+        heap->useSize = (size > MEM_TAG_SIZE_MAX) ? MEM_TAG_SIZE_MAX : size;
+        os_freeListRebuild(heap);
+        return;
+    }
+
+    heap->mapStart = start;
+    heap->mapSize = size / 3;
+    heap->useStart = start + heap->mapSize;
+    heap->useSize = heap->mapSize * 2;
+
+    // An empty map marks every byte of the use area as free
+    MemValue const zeros[MEM_BLOCK_SIZE] = {0};
+    for (MemAddr addr = heap->mapStart; addr < heap->useStart; addr += MEM_BLOCK_SIZE) {
+        uint16_t const left = heap->useStart - addr;
+        heap->driver->writeBlock(addr, zeros, (left < MEM_BLOCK_SIZE) ? left : MEM_BLOCK_SIZE);
+    }
+    os_freeListRebuild(heap);
+}
+
+/*!
+ *  Initializes all heaps. The memory devices have to be initialized before.
+ */
+void os_initHeaps(void) {
+    MemAddr const start = (MemAddr)&__heap_start;
+    if (start >= TOP_OF_PROCS_STACK) {
+        os_error("Kein Platz fuer Heap");
+        return;
+    }
+    os_initHeap(intHeap, start, TOP_OF_PROCS_STACK - start);
+#if EXTERNAL_SRAM
+    os_initHeap(extHeap, extSRAM->start, extSRAM->size);
+#endif
+}
+
+/*!
+ *  Returns the number of heaps.
+ *
+ *  \return The number of heaps.
+ */
+uint8_t os_getHeapListLength(void) {
+    return sizeof(os_heaps) / sizeof(os_heaps[0]);
+}
+
+/*!
+ *  Returns the heap with the passed index.
+ *
+ *  \param index The index of the heap.
+ *  \return The heap or NULL if there is no heap with this index.
+ */
+Heap* os_lookupHeap(uint8_t index) {
+    if (index >= os_getHeapListLength()) {
+        return NULL;
+    }
+    return os_heaps[index];
+}
@@ -0,0 +1,230 @@
+/*! \file
+ *  \brief Heaps managed by the memory module.
+ *
+ *  Contains the description of every heap, i.e. on which memory device it
+ *  resides, where its map and use area lie and how it allocates memory.
+ */
+
+#ifndef _OS_MEMHEAP_DRIVERS_H
+#define _OS_MEMHEAP_DRIVERS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "defines.h"
+#include "os_mem_drivers.h"
+
+//----------------------------------------------------------------------------
+// Free-list index
+//----------------------------------------------------------------------------
+
+//! The smallest free region that is kept in a free list (header and footer must fit)
+#define MEM_FREE_BLOCK_MIN              8
+
+//! log2 of MEM_FREE_BLOCK_MIN, the first level of the smallest free list
+#define MEM_TLSF_FL_MIN                 3
+
+//! Number of first levels (power-of-two size ranges) up to the 16-bit limit
+#define MEM_TLSF_FL_COUNT               (16 - MEM_TLSF_FL_MIN)
+
+//! Largest block of the tag layout, as the upper nibble of a tag holds the owner
+#define MEM_TAG_SIZE_MAX                0x0FFF
+
+//! log2 of the number of free lists every first level is split into
+#define MEM_TLSF_SL_BITS                2
+
+//! Number of free lists every first level is split into
+#define MEM_TLSF_SL_COUNT               (1 << MEM_TLSF_SL_BITS)
+
+//----------------------------------------------------------------------------
+// Allocation cache
+//----------------------------------------------------------------------------
+
+//! Number of size classes small allocations are rounded up to
+#define MEM_CACHE_CLASS_COUNT           4
+
+//! The sizes of the classes in ascending order (at least 2, the cache links are stored in the chunks)
+#define MEM_CACHE_CLASS_SIZES           {4, 8, 16, 32}
+
+//! The size of the largest class
+#define MEM_CACHE_MAX_SIZE              32
+
+//! Number of chunks a process takes from the heap at once when its cache of a class is empty
+#define MEM_CACHE_BATCH                 4
+
+//! Number of free chunks a process keeps per class, further chunks go back to the heap
+#define MEM_CACHE_LIMIT                 4
+
+//----------------------------------------------------------------------------
+// Relocatable chunks
+//----------------------------------------------------------------------------
+
+//! Number of handles every heap provides for chunks the compactor may move
+#ifndef MEM_HANDLE_COUNT
+#define MEM_HANDLE_COUNT                8
+#endif
+
+//! Number of bytes the compactor examines per step before it pauses
+#define MEM_COMPACT_BUDGET              64
+
+//! Largest chunk (including its link, tags or map entries) the compactor moves, as a chunk is moved in one step
+#define MEM_COMPACT_MOVE_MAX            128
+
+//! Number of bytes copied or cleared per block access of a driver (on the stack)
+#define MEM_BLOCK_SIZE                  16
+
+//----------------------------------------------------------------------------
+// Types
+//----------------------------------------------------------------------------
+
+/*!
+ *  How a heap keeps track of its chunks.
+ *  The map layout describes every byte of the use area with a nibble, which
+ *  costs a third of the heap, but any byte can be looked up directly.
+ *  The tag layout puts a two byte header and footer with owner and size
+ *  around every chunk and needs no map. Chunks are limited to
+ *  MEM_TAG_SIZE_MAX bytes, as are heaps in this layout.
+ */
+typedef enum {
+    OS_MEM_LAYOUT_MAP,
+    OS_MEM_LAYOUT_TAGS
+} MemLayout;
+
+//! All available allocation strategies
+typedef enum {
+    OS_MEM_FIRST,
+    OS_MEM_NEXT,
+    OS_MEM_BEST,
+    OS_MEM_WORST,
+    OS_MEM_TLSF
+} AllocStrategy;
+
+/*!
+ *  A heap. In the map layout its memory is split into a map and a use area.
+ *  Every byte of the use area is described by a nibble of the map, so the map
+ *  takes a third of the heap's memory. In the tag layout there is no map and
+ *  all memory is use area. Additionally, all free regions of at least
+ *  MEM_FREE_BLOCK_MIN bytes are kept in segregated free lists, which lets the
+ *  TLSF strategy find a region in constant time. Small chunks freed by a
+ *  process are kept in a cache per process and size class, so they can be
+ *  handed out again without searching the heap. The chunks of every process
+ *  are linked in a list, so they can be freed without scanning the heap when
+ *  the process terminates. Chunks allocated through a handle may be moved
+ *  towards the start of the heap by the compactor while they are not locked.
+ */
+typedef struct {
+    //! The memory device the heap resides on
+    MemDriver* driver;
+
+    //! How the heap keeps track of its chunks
+    MemLayout layout;
+
+    //! The first address of the map
+    MemAddr mapStart;
+
+    //! The size of the map in bytes
+    uint16_t mapSize;
+
+    //! The first address of the use area
+    MemAddr useStart;
+
+    //! The size of the use area in bytes
+    uint16_t useSize;
+
+    //! The allocation strategy of the heap
+    AllocStrategy strategy;
+
+    //! Where the next fit strategy continues its search
+    MemAddr nextFitStart;
+
+    //! Which first levels have a non-empty free list
+    uint16_t freeFirstLevels;
+
+    //! For every first level, which of its free lists are non-empty
+    uint8_t freeSecondLevels[MEM_TLSF_FL_COUNT];
+
+    //! The first free region of every free list (0 if empty)
+    MemAddr freeLists[MEM_TLSF_FL_COUNT][MEM_TLSF_SL_COUNT];
+
+    //! For every process and size class, the first cached chunk (0 if empty)
+    MemAddr cache[MAX_NUMBER_OF_PROCESSES][MEM_CACHE_CLASS_COUNT];
+
+    //! For every process and size class, the number of cached chunks
+    uint8_t cacheCount[MAX_NUMBER_OF_PROCESSES][MEM_CACHE_CLASS_COUNT];
+
+    //! For every size class, how often a request was served from a cache
+    uint16_t cacheHits[MEM_CACHE_CLASS_COUNT];
+
+    //! For every size class, how often a cache had to be refilled
+    uint16_t cacheMisses[MEM_CACHE_CLASS_COUNT];
+
+    //! For every process, the first chunk it owns (0 if none)
+    MemAddr ownedChunks[MAX_NUMBER_OF_PROCESSES];
+
+    //! For every handle, the chunk it refers to (0 if unused)
+    MemAddr handles[MEM_HANDLE_COUNT];
+
+    //! For every handle, how often it is locked. Locked chunks are not moved.
+    uint8_t handleLocks[MEM_HANDLE_COUNT];
+
+    //! Where the compactor continues (the start of a region)
+    MemAddr compactCursor;
+
+    //! Whether the compactor moved a chunk in its current pass
+    bool compactMoving;
+
+    //! Whether the last complete pass of the compactor moved nothing
+    bool compactSettled;
+
+    //! Number of chunks moved by the compactor (saturating)
+    uint16_t compactMoves;
+
+    //! The largest free block when the compactor last started moving chunks
+    uint16_t compactLargestBefore;
+
+    //! The name of the heap (in program memory)
+    char const* name;
+} Heap;
+
+//----------------------------------------------------------------------------
+// Globals
+//----------------------------------------------------------------------------
+
+//! The layout of the internal heap
+#ifndef INTERNAL_HEAP_LAYOUT
+#define INTERNAL_HEAP_LAYOUT            OS_MEM_LAYOUT_MAP
+#endif
+
+//! The heap in the internal SRAM
+extern Heap intHeap__;
+
+//! Handy define to pass the internal heap
+#define intHeap (&intHeap__)
+
+#if EXTERNAL_SRAM
+//! The layout of the external heap. The tag layout would only use its first MEM_TAG_SIZE_MAX bytes.
+#ifndef EXTERNAL_HEAP_LAYOUT
+#define EXTERNAL_HEAP_LAYOUT            OS_MEM_LAYOUT_MAP
+#endif
+
+//! The heap in the external SRAM
+extern Heap extHeap__;
+
+//! Handy define to pass the external heap
+#define extHeap (&extHeap__)
+#endif
+
+//----------------------------------------------------------------------------
+// Function headers
+//----------------------------------------------------------------------------
+
+//! Initializes all heaps
+void os_initHeaps(void);
+
+//! Returns the number of heaps
+uint8_t os_getHeapListLength(void);
+
+//! Returns the heap with the passed index or NULL
+Heap* os_lookupHeap(uint8_t index);
+
+#endif
@@ -0,0 +1,1276 @@
+#include "os_memory.h"
+#include "os_memory_strategies.h"
+#include "os_scheduler.h"
+#include "os_core.h"
+
+/*! \file
+ *
+ * The allocator for dynamic memory. In the map layout the map of a heap
+ * stores one nibble per byte of the use area, the high nibble of a map byte
+ * describes the lower of its two use bytes. A chunk is a leading byte holding
+ * the owner's process id followed by continuation bytes. In the tag layout
+ * every chunk is a block framed by two tags (see os_memory.h). In both
+ * layouts the address handed out lies MEM_CHUNK_LINK_SIZE bytes behind the
+ * start of the chunk (or its header), these bytes hold the links of the
+ * doubly linked list of all chunks of the owner. All heap operations run in a
+ * critical section, so they are atomic with respect to other processes.
+ *
+ */
+
+/*!
+ *  Returns the address of the map byte that holds the nibble of a use byte.
+ *
+ *  \param heap The heap of the use byte.
+ *  \param addr The address of the use byte.
+ *  \return The address of the map byte.
+ */
+static MemAddr os_getMapAddr(Heap const* heap, MemAddr addr) {
+    return heap->mapStart + (addr - heap->useStart) / 2;
+}
+
+/*!
+ *  Changes the map entry of a byte of the use area.
+ *
+ *  \param heap The heap of the byte.
+ *  \param addr The address of the byte (in the use area).
+ *  \param value The new map entry (a nibble).
+ */
+static void os_setMapEntry(Heap const* heap, MemAddr addr, MemValue value) {
+    MemAddr const mapAddr = os_getMapAddr(heap, addr);
+    MemValue const mapByte = heap->driver->read(mapAddr);
+    if ((addr - heap->useStart) & 1) {
+        heap->driver->write(mapAddr, (mapByte & 0xF0) | (value & 0x0F));
+    } else {
+        heap->driver->write(mapAddr, (mapByte & 0x0F) | (value << 4));
+    }
+}
+
+/*!
+ *  Returns the map entry of a byte of the use area of a heap in the map
+ *  layout.
+ *
+ *  \param heap The heap of the byte.
+ *  \param addr The address of the byte (in the use area).
+ *  \return The map entry (a nibble).
+ */
+static MemValue os_getMapNibble(Heap const* heap, MemAddr addr) {
+    MemValue const mapByte = heap->driver->read(os_getMapAddr(heap, addr));
+    if ((addr - heap->useStart) & 1) {
+        return mapByte & 0x0F;
+    }
+    return mapByte >> 4;
+}
+
+/*!
+ *  Reads a 16-bit value (little endian) from a heap.
+ *
+ *  \param heap The heap to read from.
+ *  \param addr The address of the lower byte.
+ *  \return The value.
+ */
+uint16_t os_readHeapWord(Heap const* heap, MemAddr addr) {
+    return heap->driver->read(addr) | ((uint16_t)heap->driver->read(addr + 1) << 8);
+}
+
+/*!
+ *  Writes a 16-bit value (little endian) to a heap.
+ *
+ *  \param heap The heap to write to.
+ *  \param addr The address of the lower byte.
+ *  \param value The value.
+ */
+void os_writeHeapWord(Heap const* heap, MemAddr addr, uint16_t value) {
+    heap->driver->write(addr, value & 0xFF);
+    heap->driver->write(addr + 1, value >> 8);
+}
+
+/*!
+ *  Returns the tag of the chunk at the passed address in the tag layout. The
+ *  address must be the one os_malloc returned. Header and footer are checked
+ *  against each other, which takes constant time.
+ *
+ *  \param heap The heap of the chunk.
+ *  \param addr The address of the chunk.
+ *  \return The tag of the chunk or 0 if addr is not an allocated chunk.
+ */
+static uint16_t os_getChunkTag(Heap const* heap, MemAddr addr) {
+    MemAddr const end = heap->useStart + heap->useSize;
+    if (addr < heap->useStart + 2 + MEM_CHUNK_LINK_SIZE || addr >= end) {
+        return 0;
+    }
+    MemAddr const block = addr - 2 - MEM_CHUNK_LINK_SIZE;
+    uint16_t const tag = os_readHeapWord(heap, block);
+    uint16_t const size = MEM_TAG_SIZE(tag);
+    if (!MEM_TAG_OWNER(tag) || size < MEM_FREE_BLOCK_MIN || size > end - block
+        || os_readHeapWord(heap, block + size - 2) != tag) {
+        return 0;
+    }
+    return tag;
+}
+
+/*!
+ *  Finds the block of the tag layout that contains the passed address by
+ *  walking the blocks from the start of the heap.
+ *
+ *  \param heap The heap to search.
+ *  \param addr An address in the use area.
+ *  \return The first address of the block.
+ */
+static MemAddr os_findTagBlock(Heap const* heap, MemAddr addr) {
+    MemAddr block = heap->useStart;
+    for (;;) {
+        MemAddr const next = block + MEM_TAG_SIZE(os_readHeapWord(heap, block));
+        if (next > addr) {
+            return block;
+        }
+        block = next;
+    }
+}
+
+/*!
+ *  Returns the map entry of a byte of the use area. For heaps in the tag
+ *  layout the entry is computed as the map layout would store it, with the
+ *  owner at the first byte behind the header and the tags counted as
+ *  continuation.
+ *  This walks the blocks and is meant for inspection only.
+ *
+ *  \param heap The heap of the byte.
+ *  \param addr The address of the byte (in the use area).
+ *  \return The map entry (a nibble).
+ */
+MemValue os_getMapEntry(Heap const* heap, MemAddr addr) {
+    if (heap->layout != OS_MEM_LAYOUT_TAGS) {
+        return os_getMapNibble(heap, addr);
+    }
+
+    MemAddr const block = os_findTagBlock(heap, addr);
+    MemValue const owner = MEM_TAG_OWNER(os_readHeapWord(heap, block));
+    if (!owner) {
+        return MEM_MAP_FREE;
+    }
+    return (addr == block + 2) ? owner : MEM_MAP_CONTINUATION;
+}
+
+/*!
+ *  Checks whether an address lies in the use area of a heap.
+ *
+ *  \param heap The heap to check.
+ *  \param addr The address to check.
+ *  \return True if addr is in the use area.
+ */
+static bool os_isInUseArea(Heap const* heap, MemAddr addr) {
+    return addr >= heap->useStart && addr < heap->useStart + heap->useSize;
+}
+
+/*!
+ *  Returns the first address of the chunk of the map layout the passed
+ *  address belongs to, i.e. the byte whose map entry holds the owner.
+ *
+ *  \param heap The heap of the chunk.
+ *  \param addr An address of the chunk (in the use area).
+ *  \return The first address of the chunk.
+ */
+static MemAddr os_getChunkStart(Heap const* heap, MemAddr addr) {
+    while (addr > heap->useStart && os_getMapNibble(heap, addr) == MEM_MAP_CONTINUATION) {
+        addr--;
+    }
+    return addr;
+}
+
+/*!
+ *  Puts a chunk at the front of the chunk list of its owner. The link to the
+ *  next chunk is stored MEM_CHUNK_LINK_SIZE bytes in front of the chunk, the
+ *  link to the previous one right behind it.
+ *
+ *  \param heap The heap of the chunk.
+ *  \param owner The owner of the chunk.
+ *  \param chunk The address of the chunk as handed out.
+ */
+static void os_linkOwnedChunk(Heap* heap, ProcessID owner, MemAddr chunk) {
+    MemAddr const next = heap->ownedChunks[owner];
+    os_writeHeapWord(heap, chunk - 4, next);
+    os_writeHeapWord(heap, chunk - 2, 0);
+    if (next) {
+        os_writeHeapWord(heap, next - 2, chunk);
+    }
+    heap->ownedChunks[owner] = chunk;
+}
+
+/*!
+ *  Removes a chunk from the chunk list of its owner in constant time.
+ *
+ *  \param heap The heap of the chunk.
+ *  \param owner The owner of the chunk.
+ *  \param chunk The address of the chunk as handed out.
+ */
+static void os_unlinkOwnedChunk(Heap* heap, ProcessID owner, MemAddr chunk) {
+    MemAddr const next = os_readHeapWord(heap, chunk - 4);
+    MemAddr const prev = os_readHeapWord(heap, chunk - 2);
+    if (prev) {
+        os_writeHeapWord(heap, prev - 4, next);
+    } else {
+        heap->ownedChunks[owner] = next;
+    }
+    if (next) {
+        os_writeHeapWord(heap, next - 2, prev);
+    }
+}
+
+/*!
+ *  Marks all bytes of a chunk of the map layout as free and merges them with
+ *  the free runs next to the chunk.
+ *
+ *  \param heap The heap of the chunk.
+ *  \param addr The first address of the chunk.
+ *  \return The number of bytes freed.
+ */
+static uint16_t os_freeChunk(Heap* heap, MemAddr addr) {
+    MemAddr const end = heap->useStart + heap->useSize;
+    MemAddr last = addr;
+    os_setMapEntry(heap, addr, MEM_MAP_FREE);
+    for (last++; last < end && os_getMapNibble(heap, last) == MEM_MAP_CONTINUATION; last++) {
+        os_setMapEntry(heap, last, MEM_MAP_FREE);
+    }
+    os_freeListRelease(heap, addr, last - addr);
+    return last - addr;
+}
+
+/*!
+ *  Allocates a chunk from the general heap, using the allocation strategy of
+ *  the heap, and puts it into the chunk list of its owner. Must be called
+ *  inside a critical section.
+ *
+ *  \param heap The heap to allocate from.
+ *  \param size The number of bytes to allocate.
+ *  \param owner The process that owns the chunk.
+ *  \return The address of the chunk or 0 if no region is large enough.
+ */
+static MemAddr os_allocChunk(Heap* heap, uint16_t size, ProcessID owner) {
+    // The region holds the links and in the tag layout a whole block including its tags
+    if (size > UINT16_MAX - MEM_CHUNK_LINK_SIZE) {
+        return 0;
+    }
+    uint16_t needed = size + MEM_CHUNK_LINK_SIZE;
+    if (heap->layout == OS_MEM_LAYOUT_TAGS) {
+        if (needed > MEM_TAG_SIZE_MAX - MEM_TAG_OVERHEAD) {
+            return 0;
+        }
+        needed += MEM_TAG_OVERHEAD;
+        if (needed < MEM_FREE_BLOCK_MIN) {
+            needed = MEM_FREE_BLOCK_MIN;
+        }
+    }
+
+    MemAddr addr;
+    switch (heap->strategy) {
+        case OS_MEM_NEXT:  addr = os_Memory_NextFit(heap, needed);  break;
+        case OS_MEM_BEST:  addr = os_Memory_BestFit(heap, needed);  break;
+        case OS_MEM_WORST: addr = os_Memory_WorstFit(heap, needed); break;
+        case OS_MEM_TLSF:  addr = os_Memory_TLSF(heap, needed);     break;
+        default:           addr = os_Memory_FirstFit(heap, needed); break;
+    }
+    if (!addr) {
+        return 0;
+    }
+
+    uint16_t const taken = os_freeListTake(heap, addr, needed);
+    MemAddr const next = addr + taken;
+    heap->nextFitStart = (next < heap->useStart + heap->useSize) ? next : heap->useStart;
+    if (heap->layout == OS_MEM_LAYOUT_TAGS) {
+        os_writeHeapWord(heap, addr, MEM_TAG(owner, taken));
+        os_writeHeapWord(heap, addr + taken - 2, MEM_TAG(owner, taken));
+        addr += 2;
+    } else {
+        os_setMapEntry(heap, addr, owner);
+        for (uint16_t i = 1; i < needed; i++) {
+            os_setMapEntry(heap, addr + i, MEM_MAP_CONTINUATION);
+        }
+    }
+
+    MemAddr const chunk = addr + MEM_CHUNK_LINK_SIZE;
+    os_linkOwnedChunk(heap, owner, chunk);
+    return chunk;
+}
+
+/*!
+ *  Removes a chunk from the chunk list of its owner and returns it to the
+ *  general heap. Must be called inside a critical section.
+ *
+ *  \param heap The heap of the chunk.
+ *  \param chunk The address of the chunk as handed out.
+ *  \return The number of bytes returned, including tags and links.
+ */
+static uint16_t os_releaseChunk(Heap* heap, MemAddr chunk) {
+    if (heap->layout == OS_MEM_LAYOUT_TAGS) {
+        MemAddr const block = chunk - 2 - MEM_CHUNK_LINK_SIZE;
+        uint16_t const tag = os_readHeapWord(heap, block);
+        os_unlinkOwnedChunk(heap, MEM_TAG_OWNER(tag), chunk);
+        os_freeListRelease(heap, block, MEM_TAG_SIZE(tag));
+        return MEM_TAG_SIZE(tag);
+    }
+    MemAddr const start = chunk - MEM_CHUNK_LINK_SIZE;
+    os_unlinkOwnedChunk(heap, os_getMapNibble(heap, start), chunk);
+    return os_freeChunk(heap, start);
+}
+
+//! The sizes of the cached classes
+static uint8_t const os_cacheClassSizes[MEM_CACHE_CLASS_COUNT] = MEM_CACHE_CLASS_SIZES;
+
+/*!
+ *  Returns the smallest size class that can hold the passed size.
+ *
+ *  \param size The number of bytes requested.
+ *  \return The size class or MEM_CACHE_CLASS_COUNT if the size is not cached.
+ */
+static uint8_t os_getSizeClass(uint16_t size) {
+    uint8_t cls = 0;
+    while (cls < MEM_CACHE_CLASS_COUNT && os_cacheClassSizes[cls] < size) {
+        cls++;
+    }
+    return cls;
+}
+
+/*!
+ *  Returns the size class a free chunk can be cached in, i.e. the largest
+ *  class that is not larger than the chunk. In the map layout at most
+ *  MEM_CACHE_MAX_SIZE + 1 map entries are read.
+ *
+ *  \param heap The heap of the chunk.
+ *  \param chunk The address of the chunk as handed out.
+ *  \return The size class or MEM_CACHE_CLASS_COUNT if the chunk is not cached.
+ */
+static uint8_t os_getChunkClass(Heap const* heap, MemAddr chunk) {
+    uint16_t size;
+    if (heap->layout == OS_MEM_LAYOUT_TAGS) {
+        size = MEM_TAG_SIZE(os_readHeapWord(heap, chunk - 2 - MEM_CHUNK_LINK_SIZE))
+               - MEM_TAG_OVERHEAD - MEM_CHUNK_LINK_SIZE;
+    } else {
+        // All bytes handed out are continuation bytes, as the links come first
+        MemAddr const end = heap->useStart + heap->useSize;
+        size = 0;
+        while (size <= MEM_CACHE_MAX_SIZE && chunk + size < end
+               && os_getMapNibble(heap, chunk + size) == MEM_MAP_CONTINUATION) {
+            size++;
+        }
+    }
+    if (size > MEM_CACHE_MAX_SIZE || size < os_cacheClassSizes[0]) {
+        return MEM_CACHE_CLASS_COUNT;
+    }
+    uint8_t cls = MEM_CACHE_CLASS_COUNT - 1;
+    while (os_cacheClassSizes[cls] > size) {
+        cls--;
+    }
+    return cls;
+}
+
+/*!
+ *  Takes a chunk from the cache of a process. The link to the next cached
+ *  chunk is stored in the first two bytes of every cached chunk.
+ *
+ *  \param heap The heap of the cache.
+ *  \param pid The process whose cache is used.
+ *  \param cls The size class.
+ *  \return The address of the chunk or 0 if the cache is empty.
+ */
+static MemAddr os_cachePop(Heap* heap, ProcessID pid, uint8_t cls) {
+    MemAddr const chunk = heap->cache[pid][cls];
+    if (chunk) {
+        heap->cache[pid][cls] = os_readHeapWord(heap, chunk);
+        heap->cacheCount[pid][cls]--;
+    }
+    return chunk;
+}
+
+/*!
+ *  Finds the handle that refers to a chunk. At most one handle refers to a
+ *  chunk.
+ *
+ *  \param heap The heap of the chunk.
+ *  \param chunk The address of the chunk as handed out.
+ *  \return The index of the handle or MEM_HANDLE_COUNT if there is none.
+ */
+static uint8_t os_findHandle(Heap const* heap, MemAddr chunk) {
+    uint8_t handle = 0;
+    while (handle < MEM_HANDLE_COUNT && heap->handles[handle] != chunk) {
+        handle++;
+    }
+    return handle;
+}
+
+/*!
+ *  Checks whether a chunk is in the cache of the passed process. Cached
+ *  chunks keep their owner in the map or tags, so this is the only way to
+ *  tell that such a chunk was already freed. A cache holds at most
+ *  MEM_CACHE_LIMIT chunks, so the search is short.
+ *
+ *  \param heap The heap of the chunk.
+ *  \param pid The owner of the chunk.
+ *  \param chunk The address of the chunk as handed out.
+ *  \return True if the chunk is cached.
+ */
+static bool os_isCached(Heap const* heap, ProcessID pid, MemAddr chunk) {
+    uint8_t const cls = os_getChunkClass(heap, chunk);
+    if (cls >= MEM_CACHE_CLASS_COUNT) {
+        return false;
+    }
+    for (MemAddr cached = heap->cache[pid][cls]; cached; cached = os_readHeapWord(heap, cached)) {
+        if (cached == chunk) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+ *  Puts a free chunk into the cache of its owner if it fits a size class
+ *  and the cache is not full.
+ *
+ *  \param heap The heap of the chunk.
+ *  \param pid The owner of the chunk.
+ *  \param chunk The address of the chunk as handed out.
+ *  \return True if the chunk was cached.
+ */
+static bool os_cachePush(Heap* heap, ProcessID pid, MemAddr chunk) {
+    uint8_t const cls = os_getChunkClass(heap, chunk);
+    if (cls >= MEM_CACHE_CLASS_COUNT || heap->cacheCount[pid][cls] >= MEM_CACHE_LIMIT) {
+        return false;
+    }
+    os_writeHeapWord(heap, chunk, heap->cache[pid][cls]);
+    heap->cache[pid][cls] = chunk;
+    heap->cacheCount[pid][cls]++;
+    return true;
+}
+
+/*!
+ *  Returns all cached chunks of all processes to the general heap. This is
+ *  done when the general heap cannot satisfy a request.
+ *
+ *  \param heap The heap whose caches are drained.
+ *  \return True if any chunk was returned.
+ */
+static bool os_cacheDrain(Heap* heap) {
+    bool drained = false;
+    for (ProcessID pid = 1; pid < MAX_NUMBER_OF_PROCESSES; pid++) {
+        for (uint8_t cls = 0; cls < MEM_CACHE_CLASS_COUNT; cls++) {
+            MemAddr chunk;
+            while ((chunk = os_cachePop(heap, pid, cls))) {
+                os_releaseChunk(heap, chunk);
+                drained = true;
+            }
+        }
+    }
+    return drained;
+}
+
+/*!
+ *  Allocates a chunk of memory on the passed heap for the current process.
+ *  Small requests are rounded up to a size class and served from the cache
+ *  of the process. An empty cache is refilled with MEM_CACHE_BATCH chunks at
+ *  once. Everything else is allocated by the strategy of the heap. If the
+ *  heap is exhausted, all caches are drained and the request is retried.
+ *  The memory is not initialized.
+ *
+ *  \param heap The heap to allocate from.
+ *  \param size The number of bytes to allocate.
+ *  \return The address of the chunk or 0 if no region is large enough.
+ */
+MemAddr os_malloc(Heap* heap, uint16_t size) {
+    ProcessID const owner = os_getCurrentProc();
+    if (!size || owner == 0 || owner >= MAX_NUMBER_OF_PROCESSES) {
+        return 0;
+    }
+
+    os_enterCriticalSection();
+
+    MemAddr addr = 0;
+    uint8_t const cls = os_getSizeClass(size);
+    if (cls < MEM_CACHE_CLASS_COUNT) {
+        size = os_cacheClassSizes[cls];
+        addr = os_cachePop(heap, owner, cls);
+        if (addr) {
+            if (heap->cacheHits[cls] < UINT16_MAX) {
+                heap->cacheHits[cls]++;
+            }
+        } else {
+            if (heap->cacheMisses[cls] < UINT16_MAX) {
+                heap->cacheMisses[cls]++;
+            }
+            addr = os_allocChunk(heap, size, owner);
+            for (uint8_t i = 1; addr && i < MEM_CACHE_BATCH; i++) {
+                MemAddr const spare = os_allocChunk(heap, size, owner);
+                if (!spare || !os_cachePush(heap, owner, spare)) {
+                    if (spare) {
+                        os_releaseChunk(heap, spare);
+                    }
+                    break;
+                }
+            }
+        }
+    } else {
+        addr = os_allocChunk(heap, size, owner);
+    }
+
+    if (!addr && os_cacheDrain(heap)) {
+        addr = os_allocChunk(heap, size, owner);
+    }
+
+    os_leaveCriticalSection();
+    return addr;
+}
+
+/*!
+ *  Frees a chunk of the current process. In the map layout any address
+ *  within the chunk may be passed, in the tag layout it has to be the address
+ *  os_malloc returned. Chunks of a size class are kept in the cache of the
+ *  process as long as it is not full. Freeing memory of another process,
+ *  freeing a chunk twice or freeing a chunk of a handle (use os_hfree) is an
+ *  error.
+ *
+ *  \param heap The heap the chunk was allocated from.
+ *  \param addr An address of the chunk.
+ */
+void os_free(Heap* heap, MemAddr addr) {
+    ProcessID const owner = os_getCurrentProc();
+    os_enterCriticalSection();
+
+    MemAddr chunk = 0;
+    if (heap->layout == OS_MEM_LAYOUT_TAGS) {
+        uint16_t const tag = os_getChunkTag(heap, addr);
+        if (!tag) {
+            os_error("Ungueltige Adresse freigegeben");
+        } else if (MEM_TAG_OWNER(tag) != owner) {
+            os_error("Fremder Speicher freigegeben");
+        } else {
+            chunk = addr;
+        }
+    } else if (!os_isInUseArea(heap, addr) || os_getMapNibble(heap, addr) == MEM_MAP_FREE) {
+        os_error("Ungueltige Adresse freigegeben");
+    } else {
+        MemAddr const first = os_getChunkStart(heap, addr);
+        if (os_getMapNibble(heap, first) != owner) {
+            os_error("Fremder Speicher freigegeben");
+        } else {
+            chunk = first + MEM_CHUNK_LINK_SIZE;
+        }
+    }
+
+    if (chunk && os_isCached(heap, owner, chunk)) {
+        os_error("Speicher doppelt freigegeben");
+        chunk = 0;
+    }
+    // The handle would still refer to the chunk once it is reused
+    if (chunk && os_findHandle(heap, chunk) < MEM_HANDLE_COUNT) {
+        os_error("Handle-Speicher mit os_free freigegeben");
+        chunk = 0;
+    }
+
+    if (chunk && !os_cachePush(heap, owner, chunk)) {
+        os_releaseChunk(heap, chunk);
+    }
+
+    os_leaveCriticalSection();
+}
+
+/*!
+ *  Copies bytes within a heap. The bytes are moved in blocks of
+ *  MEM_BLOCK_SIZE through the block access of the driver, which saves the
+ *  command and address of every byte on devices like the external SRAM.
+ *  The regions may overlap if the destination lies in front of the source, as
+ *  every block is read before it is written.
+ *
+ *  \param heap The heap to copy in.
+ *  \param to The first address of the destination.
+ *  \param from The first address of the source.
+ *  \param length The number of bytes to copy.
+ */
+static void os_copyHeapBytes(Heap const* heap, MemAddr to, MemAddr from, uint16_t length) {
+    MemValue buffer[MEM_BLOCK_SIZE];
+    while (length) {
+        uint16_t const part = (length < MEM_BLOCK_SIZE) ? length : MEM_BLOCK_SIZE;
+        heap->driver->readBlock(from, buffer, part);
+        heap->driver->writeBlock(to, buffer, part);
+        from += part;
+        to += part;
+        length -= part;
+    }
+}
+
+/*!
+ *  Moves next fit and the compactor out of a region that became part of a
+ *  chunk.
+ *
+ *  \param heap The heap of the chunk.
+ *  \param start The first address of the chunk (or its block).
+ *  \param from The first address of the region added to the chunk.
+ *  \param to The address behind the region.
+ */
+static void os_leaveGrownRegion(Heap* heap, MemAddr start, MemAddr from, MemAddr to) {
+    if (heap->nextFitStart >= from && heap->nextFitStart < to) {
+        heap->nextFitStart = (to < heap->useStart + heap->useSize) ? to : heap->useStart;
+    }
+    if (heap->compactCursor >= from && heap->compactCursor < to) {
+        heap->compactCursor = start;
+    }
+}
+
+/*!
+ *  Changes the size of a chunk in place. A chunk shrinks by giving its end
+ *  back to the heap and grows into the free region directly behind it.
+ *  Must be called inside a critical section.
+ *
+ *  \param heap The heap of the chunk.
+ *  \param chunk The address of the chunk as handed out.
+ *  \param oldSize The current size of the chunk.
+ *  \param size The requested size.
+ *  \return True if the chunk now has at least the requested size.
+ */
+static bool os_resizeChunk(Heap* heap, MemAddr chunk, uint16_t oldSize, uint16_t size) {
+    MemAddr const end = heap->useStart + heap->useSize;
+
+    if (heap->layout == OS_MEM_LAYOUT_TAGS) {
+        MemAddr const block = chunk - 2 - MEM_CHUNK_LINK_SIZE;
+        uint16_t const tag = os_readHeapWord(heap, block);
+        uint16_t const blockSize = MEM_TAG_SIZE(tag);
+        if (size > MEM_TAG_SIZE_MAX - MEM_TAG_OVERHEAD - MEM_CHUNK_LINK_SIZE) {
+            return false;
+        }
+        uint16_t needed = size + MEM_TAG_OVERHEAD + MEM_CHUNK_LINK_SIZE;
+        if (needed < MEM_FREE_BLOCK_MIN) {
+            needed = MEM_FREE_BLOCK_MIN;
+        }
+
+        uint16_t newSize = blockSize;
+        if (needed <= blockSize) {
+            // The rest must be large enough for a free block
+            if (blockSize - needed < MEM_FREE_BLOCK_MIN) {
+                return true;
+            }
+            newSize = needed;
+        } else {
+            MemAddr const behind = block + blockSize;
+            if (behind >= end) {
+                return false;
+            }
+            uint16_t const behindTag = os_readHeapWord(heap, behind);
+            if (MEM_TAG_OWNER(behindTag) || blockSize + behindTag < needed) {
+                return false;
+            }
+            newSize = blockSize + os_freeListTake(heap, behind, needed - blockSize);
+            os_leaveGrownRegion(heap, block, behind, block + newSize);
+        }
+
+        os_writeHeapWord(heap, block, MEM_TAG(MEM_TAG_OWNER(tag), newSize));
+        os_writeHeapWord(heap, block + newSize - 2, MEM_TAG(MEM_TAG_OWNER(tag), newSize));
+        if (newSize < blockSize) {
+            os_freeListRelease(heap, block + newSize, blockSize - newSize);
+        }
+        return true;
+    }
+
+    MemAddr const behind = chunk + oldSize;
+    if (size <= oldSize) {
+        for (MemAddr addr = chunk + size; addr < behind; addr++) {
+            os_setMapEntry(heap, addr, MEM_MAP_FREE);
+        }
+        if (size < oldSize) {
+            os_freeListRelease(heap, chunk + size, oldSize - size);
+        }
+        return true;
+    }
+
+    uint16_t const grow = size - oldSize;
+    if (behind >= end || os_getMapNibble(heap, behind) != MEM_MAP_FREE
+        || os_getFreeRunSize(heap, behind) < grow) {
+        return false;
+    }
+    os_freeListTake(heap, behind, grow);
+    for (MemAddr addr = behind; addr < behind + grow; addr++) {
+        os_setMapEntry(heap, addr, MEM_MAP_CONTINUATION);
+    }
+    os_leaveGrownRegion(heap, chunk - MEM_CHUNK_LINK_SIZE, behind, behind + grow);
+    return true;
+}
+
+/*!
+ *  Changes the size of a chunk of the current process. The chunk is shrunk
+ *  or grown in place if possible, which needs no copying. Only if the free
+ *  region behind the chunk is too small, a new chunk is allocated, the
+ *  contents are copied and the old chunk is freed. A handle referring to the
+ *  chunk follows it. A chunk whose handle is locked is never moved, as its
+ *  address is in use.
+ *  As with realloc, an address of 0 allocates a new chunk and a size of 0
+ *  frees the chunk, which is an error for the chunk of a handle as in
+ *  os_free.
+ *
+ *  \param heap The heap the chunk was allocated from.
+ *  \param addr The address os_malloc returned for the chunk or 0.
+ *  \param size The new size of the chunk in bytes.
+ *  \return The (possibly new) address of the chunk, 0 if the size is 0, there
+ *          is not enough memory or the chunk would have to be moved while
+ *          its handle is locked. In the latter cases the chunk is left
+ *          unchanged.
+ */
+MemAddr os_realloc(Heap* heap, MemAddr addr, uint16_t size) {
+    if (!addr) {
+        return os_malloc(heap, size);
+    }
+    if (!size) {
+        os_free(heap, addr);
+        return 0;
+    }
+
+    ProcessID const owner = os_getCurrentProc();
+    os_enterCriticalSection();
+
+    // In the tag layout the owner is only found at the address handed out
+    bool valid = (os_getOwnerOfChunk(heap, addr) == owner);
+    if (valid && heap->layout == OS_MEM_LAYOUT_MAP) {
+        valid = (os_getChunkStart(heap, addr) + MEM_CHUNK_LINK_SIZE == addr);
+    }
+    // A cached chunk was freed already
+    valid = valid && !os_isCached(heap, owner, addr);
+
+    MemAddr result = 0;
+    if (!valid) {
+        os_error("Ungueltige Adresse vergroessert");
+    } else {
+        uint16_t const oldSize = os_getChunkSize(heap, addr);
+        uint8_t const handle = os_findHandle(heap, addr);
+        bool const locked = (handle < MEM_HANDLE_COUNT && heap->handleLocks[handle]);
+
+        if (os_resizeChunk(heap, addr, oldSize, size)) {
+            result = addr;
+        } else if (!locked && (result = os_malloc(heap, size))) {
+            os_copyHeapBytes(heap, result, addr, oldSize);
+            if (handle < MEM_HANDLE_COUNT) {
+                heap->handles[handle] = result;
+            }
+            os_free(heap, addr);
+        }
+    }
+
+    os_leaveCriticalSection();
+    return result;
+}
+
+/*!
+ *  Frees all chunks owned by the passed process, including the chunks in its
+ *  cache. This is used by os_kill, so the memory of terminated processes is
+ *  not lost. Only the chunk list of the process is walked, so this takes
+ *  time linear in the number of its chunks instead of the size of the heap.
+ *
+ *  \param heap The heap to clean up.
+ *  \param pid The process whose chunks are freed.
+ *  \return The number of bytes returned to the heap, including tags and links.
+ */
+uint16_t os_freeProcessMemory(Heap* heap, ProcessID pid) {
+    if (pid == 0 || pid >= MAX_NUMBER_OF_PROCESSES) {
+        return 0;
+    }
+
+    os_enterCriticalSection();
+
+    // Cached chunks are still owned by the process and freed below
+    for (uint8_t cls = 0; cls < MEM_CACHE_CLASS_COUNT; cls++) {
+        heap->cache[pid][cls] = 0;
+        heap->cacheCount[pid][cls] = 0;
+    }
+    for (uint8_t handle = 0; handle < MEM_HANDLE_COUNT; handle++) {
+        if (heap->handles[handle] && os_getOwnerOfChunk(heap, heap->handles[handle]) == pid) {
+            heap->handles[handle] = 0;
+            heap->handleLocks[handle] = 0;
+        }
+    }
+
+    uint16_t freed = 0;
+    MemAddr chunk;
+    while ((chunk = heap->ownedChunks[pid])) {
+        freed += os_releaseChunk(heap, chunk);
+    }
+
+    os_leaveCriticalSection();
+    return freed;
+}
+
+/*!
+ *  Returns the address os_malloc handed out for the chunk the passed address
+ *  belongs to. In the tag layout this walks the blocks.
+ *
+ *  \param heap The heap of the chunk.
+ *  \param addr An address of the chunk (in the use area).
+ *  \return The first address of the chunk that is handed out.
+ */
+MemAddr os_getFirstByteOfChunk(Heap const* heap, MemAddr addr) {
+    if (heap->layout == OS_MEM_LAYOUT_TAGS) {
+        return os_findTagBlock(heap, addr) + 2 + MEM_CHUNK_LINK_SIZE;
+    }
+    return os_getChunkStart(heap, addr) + MEM_CHUNK_LINK_SIZE;
+}
+
+/*!
+ *  Returns the size of the chunk the passed address belongs to. In the map
+ *  layout any address within the chunk may be passed. In the tag layout it
+ *  has to be the address os_malloc returned, the size is then read from the
+ *  header in constant time.
+ *
+ *  \param heap The heap of the chunk.
+ *  \param addr An address of the chunk.
+ *  \return The size of the chunk in bytes, 0 if addr is not allocated.
+ */
+uint16_t os_getChunkSize(Heap const* heap, MemAddr addr) {
+    if (heap->layout == OS_MEM_LAYOUT_TAGS) {
+        uint16_t const tag = os_getChunkTag(heap, addr);
+        return tag ? MEM_TAG_SIZE(tag) - MEM_TAG_OVERHEAD - MEM_CHUNK_LINK_SIZE : 0;
+    }
+    if (!os_isInUseArea(heap, addr) || os_getMapNibble(heap, addr) == MEM_MAP_FREE) {
+        return 0;
+    }
+    MemAddr const end = heap->useStart + heap->useSize;
+    MemAddr const first = os_getChunkStart(heap, addr);
+    MemAddr last = first + 1;
+    while (last < end && os_getMapNibble(heap, last) == MEM_MAP_CONTINUATION) {
+        last++;
+    }
+    return last - first - MEM_CHUNK_LINK_SIZE;
+}
+
+/*!
+ *  Returns the owner of the chunk the passed address belongs to. The same
+ *  rules as for os_getChunkSize apply to the address.
+ *
+ *  \param heap The heap of the chunk.
+ *  \param addr An address of the chunk.
+ *  \return The owner of the chunk or INVALID_PROCESS if addr is not allocated.
+ */
+ProcessID os_getOwnerOfChunk(Heap const* heap, MemAddr addr) {
+    if (heap->layout == OS_MEM_LAYOUT_TAGS) {
+        uint16_t const tag = os_getChunkTag(heap, addr);
+        return tag ? MEM_TAG_OWNER(tag) : INVALID_PROCESS;
+    }
+    if (!os_isInUseArea(heap, addr) || os_getMapNibble(heap, addr) == MEM_MAP_FREE) {
+        return INVALID_PROCESS;
+    }
+    return os_getMapNibble(heap, os_getChunkStart(heap, addr));
+}
+
+/*!
+ *  Returns the size of the map of a heap.
+ *
+ *  \param heap The heap to examine.
+ *  \return The size of the map in bytes.
+ */
+uint16_t os_getMapSize(Heap const* heap) {
+    return heap->mapSize;
+}
+
+/*!
+ *  Returns the size of the use area of a heap.
+ *
+ *  \param heap The heap to examine.
+ *  \return The size of the use area in bytes.
+ */
+uint16_t os_getUseSize(Heap const* heap) {
+    return heap->useSize;
+}
+
+/*!
+ *  Returns the first address of the map of a heap.
+ *
+ *  \param heap The heap to examine.
+ *  \return The first address of the map.
+ */
+MemAddr os_getMapStart(Heap const* heap) {
+    return heap->mapStart;
+}
+
+/*!
+ *  Returns the first address of the use area of a heap.
+ *
+ *  \param heap The heap to examine.
+ *  \return The first address of the use area.
+ */
+MemAddr os_getUseStart(Heap const* heap) {
+    return heap->useStart;
+}
+
+/*!
+ *  Changes the allocation strategy of a heap. Allocated chunks are not
+ *  affected, so the strategy may be changed at any time.
+ *
+ *  \param heap The heap to change.
+ *  \param allocStrat The new allocation strategy.
+ */
+void os_setAllocationStrategy(Heap* heap, AllocStrategy allocStrat) {
+    os_enterCriticalSection();
+    heap->strategy = allocStrat;
+    heap->nextFitStart = heap->useStart;
+    os_leaveCriticalSection();
+}
+
+/*!
+ *  Returns the size of a cached size class.
+ *
+ *  \param cls The size class.
+ *  \return The size of the chunks of the class in bytes.
+ */
+uint8_t os_getCacheClassSize(uint8_t cls) {
+    return os_cacheClassSizes[cls];
+}
+
+/*!
+ *  Returns how often a request of a size class was served from a cache.
+ *
+ *  \param heap The heap to examine.
+ *  \param cls The size class.
+ *  \return The number of hits (saturates at UINT16_MAX).
+ */
+uint16_t os_getCacheHits(Heap const* heap, uint8_t cls) {
+    return heap->cacheHits[cls];
+}
+
+/*!
+ *  Returns how often a cache of a size class had to be refilled.
+ *
+ *  \param heap The heap to examine.
+ *  \param cls The size class.
+ *  \return The number of misses (saturates at UINT16_MAX).
+ */
+uint16_t os_getCacheMisses(Heap const* heap, uint8_t cls) {
+    return heap->cacheMisses[cls];
+}
+
+/*!
+ *  Returns how many chunks of a size class are cached by all processes.
+ *
+ *  \param heap The heap to examine.
+ *  \param cls The size class.
+ *  \return The number of cached chunks.
+ */
+uint16_t os_getCachedChunks(Heap const* heap, uint8_t cls) {
+    uint16_t count = 0;
+    for (ProcessID pid = 0; pid < MAX_NUMBER_OF_PROCESSES; pid++) {
+        count += heap->cacheCount[pid][cls];
+    }
+    return count;
+}
+
+/*!
+ *  Returns the allocation strategy of a heap.
+ *
+ *  \param heap The heap to examine.
+ *  \return The allocation strategy of the heap.
+ */
+AllocStrategy os_getAllocationStrategy(Heap const* heap) {
+    return heap->strategy;
+}
+
+/*!
+ *  Returns the index of a handle in the handle table of a heap. An invalid
+ *  or unused handle is an error.
+ *
+ *  \param heap The heap of the handle.
+ *  \param handle The handle to look up.
+ *  \return The index of the handle or MEM_HANDLE_COUNT if it is invalid.
+ */
+static uint8_t os_getHandleIndex(Heap const* heap, MemHandle handle) {
+    if (handle == MEM_INVALID_HANDLE || handle > MEM_HANDLE_COUNT || !heap->handles[handle - 1]) {
+        os_error("Ungueltiges Handle");
+        return MEM_HANDLE_COUNT;
+    }
+    return handle - 1;
+}
+
+/*!
+ *  Allocates a chunk for the current process that is referred to by a
+ *  handle instead of its address. As long as the handle is not locked, the
+ *  compactor may move the chunk. The chunk is freed with the other memory of
+ *  the process when it terminates.
+ *
+ *  \param heap The heap to allocate from.
+ *  \param size The number of bytes to allocate.
+ *  \return The handle or MEM_INVALID_HANDLE if no handle or no region is available.
+ */
+MemHandle os_hmalloc(Heap* heap, uint16_t size) {
+    os_enterCriticalSection();
+
+    MemHandle result = MEM_INVALID_HANDLE;
+    for (uint8_t handle = 0; handle < MEM_HANDLE_COUNT; handle++) {
+        if (!heap->handles[handle]) {
+            MemAddr const chunk = os_malloc(heap, size);
+            if (chunk) {
+                heap->handles[handle] = chunk;
+                heap->handleLocks[handle] = 0;
+                result = handle + 1;
+            }
+            break;
+        }
+    }
+
+    os_leaveCriticalSection();
+    return result;
+}
+
+/*!
+ *  Locks the chunk of a handle, so the compactor does not move it, and
+ *  returns its address. The address stays valid until the handle is
+ *  unlocked as often as it was locked.
+ *
+ *  \param heap The heap of the handle.
+ *  \param handle The handle to lock.
+ *  \return The address of the chunk or 0 if the handle is invalid.
+ */
+MemAddr os_hlock(Heap* heap, MemHandle handle) {
+    os_enterCriticalSection();
+
+    MemAddr chunk = 0;
+    uint8_t const index = os_getHandleIndex(heap, handle);
+    if (index < MEM_HANDLE_COUNT) {
+        if (heap->handleLocks[index] == UINT8_MAX) {
+            os_error("Handle zu oft gesperrt");
+        } else {
+            heap->handleLocks[index]++;
+            chunk = heap->handles[index];
+        }
+    }
+
+    os_leaveCriticalSection();
+    return chunk;
+}
+
+/*!
+ *  Unlocks the chunk of a handle. Addresses obtained by os_hlock must not be
+ *  used anymore once the handle is no longer locked.
+ *
+ *  \param heap The heap of the handle.
+ *  \param handle The handle to unlock.
+ */
+void os_hunlock(Heap* heap, MemHandle handle) {
+    os_enterCriticalSection();
+
+    uint8_t const index = os_getHandleIndex(heap, handle);
+    if (index < MEM_HANDLE_COUNT) {
+        if (!heap->handleLocks[index]) {
+            os_error("Handle nicht gesperrt");
+        } else {
+            heap->handleLocks[index]--;
+        }
+    }
+
+    os_leaveCriticalSection();
+}
+
+/*!
+ *  Frees the chunk of a handle and makes the handle available again. Only
+ *  the owner of the chunk may free it, even if the handle is locked.
+ *
+ *  \param heap The heap of the handle.
+ *  \param handle The handle to free.
+ */
+void os_hfree(Heap* heap, MemHandle handle) {
+    os_enterCriticalSection();
+
+    uint8_t const index = os_getHandleIndex(heap, handle);
+    if (index < MEM_HANDLE_COUNT) {
+        MemAddr const chunk = heap->handles[index];
+        if (os_getOwnerOfChunk(heap, chunk) != os_getCurrentProc()) {
+            os_error("Fremder Speicher freigegeben");
+        } else {
+            heap->handles[index] = 0;
+            heap->handleLocks[index] = 0;
+            os_free(heap, chunk);
+        }
+    }
+
+    os_leaveCriticalSection();
+}
+
+/*!
+ *  Returns the address behind the region starting at the passed address. In
+ *  the map layout a region is a free run or a chunk, in the tag layout it is
+ *  a block. The end of a chunk in the map layout is only found by reading
+ *  its map entries, so at most limit of them are read. If the chunk is
+ *  longer, the address reached is returned, which lies inside the chunk.
+ *  In the map layout the passed address may also lie inside a chunk, then
+ *  the rest of the chunk is the region.
+ *
+ *  \param heap The heap to examine.
+ *  \param addr The first address of the region.
+ *  \param isFree Where to store whether the region is free.
+ *  \param limit The number of bytes of a chunk to examine at most (at least 1).
+ *  \return The address behind the region or the address reached.
+ */
+static MemAddr os_getRegionEnd(Heap const* heap, MemAddr addr, bool* isFree, uint16_t limit) {
+    if (heap->layout == OS_MEM_LAYOUT_TAGS) {
+        uint16_t const tag = os_readHeapWord(heap, addr);
+        *isFree = !MEM_TAG_OWNER(tag);
+        return addr + MEM_TAG_SIZE(tag);
+    }
+
+    *isFree = (os_getMapNibble(heap, addr) == MEM_MAP_FREE);
+    if (*isFree) {
+        return addr + os_getFreeRunSize(heap, addr);
+    }
+    MemAddr const end = heap->useStart + heap->useSize;
+    MemAddr last = addr + 1;
+    while (last < end && last - addr < limit && os_getMapNibble(heap, last) == MEM_MAP_CONTINUATION) {
+        last++;
+    }
+    return last;
+}
+
+/*!
+ *  Moves a chunk to the start of the free region right in front of it. The
+ *  bytes are copied in ascending order, so the overlapping move is safe. The
+ *  links, tags and map entries move with the chunk, the chunk lists of its
+ *  owner and the handle are updated and the bytes left behind are merged with
+ *  the free region behind the chunk. This takes time linear in the size of
+ *  the chunk, regardless of the size of the free region.
+ *
+ *  \param heap The heap of the chunk.
+ *  \param from The first address of the free region.
+ *  \param start The first address of the chunk (or its block).
+ *  \param end The address behind the chunk (or its block).
+ *  \param handle The index of the handle referring to the chunk.
+ *  \return The first address of the free region behind the moved chunk.
+ */
+static MemAddr os_moveChunk(Heap* heap, MemAddr from, MemAddr start, MemAddr end, uint8_t handle) {
+    bool const tags = (heap->layout == OS_MEM_LAYOUT_TAGS);
+    ProcessID const owner = tags ? MEM_TAG_OWNER(os_readHeapWord(heap, start)) : os_getMapNibble(heap, start);
+    MemAddr const to = from + (end - start);
+
+    os_freeListTake(heap, from, start - from);
+    os_copyHeapBytes(heap, from, start, end - start);
+
+    if (tags) {
+        // A header left in the free region must not be taken for a chunk
+        if (start > to) {
+            os_writeHeapWord(heap, start, 0);
+        }
+    } else {
+        os_setMapEntry(heap, from, owner);
+        for (MemAddr addr = from + 1; addr < to; addr++) {
+            os_setMapEntry(heap, addr, MEM_MAP_CONTINUATION);
+        }
+        // Bytes in front of the old chunk are free already
+        for (MemAddr addr = (to > start) ? to : start; addr < end; addr++) {
+            os_setMapEntry(heap, addr, MEM_MAP_FREE);
+        }
+    }
+
+    // Next fit must not continue inside the moved chunk
+    if (heap->nextFitStart > from && heap->nextFitStart < end) {
+        heap->nextFitStart = from;
+    }
+
+    MemAddr const chunk = from + (tags ? 2 : 0) + MEM_CHUNK_LINK_SIZE;
+    MemAddr const next = os_readHeapWord(heap, chunk - 4);
+    MemAddr const prev = os_readHeapWord(heap, chunk - 2);
+    if (prev) {
+        os_writeHeapWord(heap, prev - 4, chunk);
+    } else {
+        heap->ownedChunks[owner] = chunk;
+    }
+    if (next) {
+        os_writeHeapWord(heap, next - 2, chunk);
+    }
+    heap->handles[handle] = chunk;
+
+    return os_freeListRelease(heap, to, start - from);
+}
+
+/*!
+ *  Performs one step of the incremental compaction of a heap. Starting where
+ *  the last step stopped, the regions of the heap are examined. The first
+ *  chunk behind a free region that is referred to by an unlocked handle is
+ *  moved to the start of that free region, so free memory collects at the
+ *  end of the heap. A step examines about MEM_COMPACT_BUDGET bytes and moves
+ *  at most one chunk of at most MEM_COMPACT_MOVE_MAX bytes, so its work is
+ *  bounded regardless of the heap and the chunks on it, and it can be run in
+ *  idle time without locking out other processes for long. In the map layout
+ *  a step may stop inside a long chunk and continues there. Chunks that are
+ *  not allocated through a handle and larger chunks are never moved.
+ *
+ *  \param heap The heap to compact.
+ *  \return True if a chunk was moved.
+ */
+bool os_compactStep(Heap* heap) {
+    os_enterCriticalSection();
+
+    MemAddr const end = heap->useStart + heap->useSize;
+    MemAddr addr = heap->compactCursor;
+    if (addr < heap->useStart || addr > end) {
+        addr = heap->useStart;
+    } else if (heap->layout == OS_MEM_LAYOUT_MAP && addr > heap->useStart && addr < end) {
+        // The cursor may lie inside a chunk, but has to be at the start of a free run, otherwise start over
+        if (os_getMapNibble(heap, addr) == MEM_MAP_FREE && os_getMapNibble(heap, addr - 1) == MEM_MAP_FREE) {
+            addr = heap->useStart;
+        }
+    }
+
+    bool moved = false;
+    uint16_t work = 0;
+    while (!moved && work < MEM_COMPACT_BUDGET) {
+        if (addr >= end) {
+            // A pass is complete, the heap has settled if it moved nothing
+            heap->compactSettled = !heap->compactMoving;
+            heap->compactMoving = false;
+            addr = heap->useStart;
+            break;
+        }
+
+        bool isFree;
+        MemAddr next = os_getRegionEnd(heap, addr, &isFree, MEM_COMPACT_BUDGET - work);
+        work += next - addr;
+        if (isFree && next < end) {
+            // Chunks longer than MEM_COMPACT_MOVE_MAX are not moved, so their end is not looked for
+            bool chunkFree;
+            MemAddr const chunkEnd = os_getRegionEnd(heap, next, &chunkFree, MEM_COMPACT_MOVE_MAX + 1);
+            MemAddr const chunk = next + (heap->layout == OS_MEM_LAYOUT_TAGS ? 2 : 0) + MEM_CHUNK_LINK_SIZE;
+            work += chunkEnd - next;
+
+            uint8_t const handle = (chunkEnd - next <= MEM_COMPACT_MOVE_MAX) ? os_findHandle(heap, chunk) : MEM_HANDLE_COUNT;
+            if (handle < MEM_HANDLE_COUNT && !heap->handleLocks[handle]) {
+                if (heap->compactSettled) {
+                    heap->compactLargestBefore = os_getLargestFreeBlock(heap);
+                    heap->compactSettled = false;
+                }
+                next = os_moveChunk(heap, addr, next, chunkEnd, handle);
+                heap->compactMoving = true;
+                if (heap->compactMoves < UINT16_MAX) {
+                    heap->compactMoves++;
+                }
+                moved = true;
+            } else {
+                next = chunkEnd;
+            }
+        }
+        addr = next;
+    }
+
+    heap->compactCursor = addr;
+    os_leaveCriticalSection();
+    return moved;
+}
+
+/*!
+ *  Returns how many chunks the compactor has moved since the heap was
+ *  initialized.
+ *
+ *  \param heap The heap to examine.
+ *  \return The number of moved chunks (saturating).
+ */
+uint16_t os_getCompactMoves(Heap const* heap) {
+    return heap->compactMoves;
+}
+
+/*!
+ *  Returns the size of the largest free block of the heap at the time the
+ *  compactor last started moving chunks after the heap had settled. Compare
+ *  with os_getLargestFreeBlock to see what compaction achieved.
+ *
+ *  \param heap The heap to examine.
+ *  \return The size of the largest free block before compaction.
+ */
+uint16_t os_getCompactLargestBefore(Heap const* heap) {
+    return heap->compactLargestBefore;
+}
@@ -0,0 +1,150 @@
+/*! \file
+ *  \brief Dynamic memory for processes.
+ *
+ *  Contains the allocator that hands out chunks of a heap to processes. Every
+ *  chunk is owned by the process that allocated it and is reclaimed when that
+ *  process terminates.
+ */
+
+#ifndef _OS_MEMORY_H
+#define _OS_MEMORY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "defines.h"
+#include "os_process.h"
+#include "os_mem_drivers.h"
+#include "os_memheap_drivers.h"
+
+/*
+ * In the map layout every byte of the use area is described by a nibble of
+ * the map. The first byte of a chunk holds the id of its owner, the following
+ * ones hold MEM_MAP_CONTINUATION, free bytes hold MEM_MAP_FREE.
+ * In the tag layout a chunk is a block with a header and a footer tag in
+ * front of and behind the data. A tag holds the owner in its upper nibble and
+ * the size of the block in the lower twelve bits. Free blocks have owner 0.
+ * In both layouts the first MEM_CHUNK_LINK_SIZE bytes of a chunk link it with
+ * the other chunks of its owner and are not handed out. The idle process
+ * (id 0) cannot own memory and the ids of all other processes must fit in a
+ * nibble, which limits the number of processes to MAX_NUMBER_OF_HEAP_PROCESSES
+ * while HEAP_SUPPORT is set (see defines.h).
+ */
+
+//! Map value of a free byte
+#define MEM_MAP_FREE            0x0
+
+//! Map value of a byte that belongs to the chunk of the byte before
+#define MEM_MAP_CONTINUATION    0xF
+
+//! Number of bytes the header and footer tags add to a chunk in the tag layout
+#define MEM_TAG_OVERHEAD        4
+
+//! Number of bytes in front of every chunk that link it with the other chunks of its owner
+#define MEM_CHUNK_LINK_SIZE     4
+
+//! Builds the tag of a block
+#define MEM_TAG(OWNER, SIZE)    (((uint16_t)(OWNER) << 12) | (SIZE))
+
+//! The owner stored in a tag (0 for free blocks)
+#define MEM_TAG_OWNER(TAG)      ((TAG) >> 12)
+
+//! The block size stored in a tag
+#define MEM_TAG_SIZE(TAG)       ((TAG) & MEM_TAG_SIZE_MAX)
+
+//----------------------------------------------------------------------------
+// Types
+//----------------------------------------------------------------------------
+
+//! Refers to a chunk that the compactor may move (1 to MEM_HANDLE_COUNT)
+typedef uint8_t MemHandle;
+
+//! The handle returned if a chunk could not be allocated
+#define MEM_INVALID_HANDLE      0
+
+//----------------------------------------------------------------------------
+// Function headers
+//----------------------------------------------------------------------------
+
+//! Allocates a chunk of at least the passed size for the current process, returns 0 on failure
+MemAddr os_malloc(Heap* heap, uint16_t size);
+
+//! Frees a chunk of the current process
+void os_free(Heap* heap, MemAddr addr);
+
+//! Resizes a chunk of the current process, in place if possible, returns 0 on failure
+MemAddr os_realloc(Heap* heap, MemAddr addr, uint16_t size);
+
+//! Frees all chunks owned by a process (used on termination), returns the number of bytes freed
+uint16_t os_freeProcessMemory(Heap* heap, ProcessID pid);
+
+//! Returns the map entry of a byte of the use area (computed for the tag layout)
+MemValue os_getMapEntry(Heap const* heap, MemAddr addr);
+
+//! Reads a 16-bit value from a heap
+uint16_t os_readHeapWord(Heap const* heap, MemAddr addr);
+
+//! Writes a 16-bit value to a heap
+void os_writeHeapWord(Heap const* heap, MemAddr addr, uint16_t value);
+
+//! Returns the first address of the chunk the passed address belongs to
+MemAddr os_getFirstByteOfChunk(Heap const* heap, MemAddr addr);
+
+//! Returns the size of the chunk the passed address belongs to
+uint16_t os_getChunkSize(Heap const* heap, MemAddr addr);
+
+//! Returns the owner of the chunk the passed address belongs to
+ProcessID os_getOwnerOfChunk(Heap const* heap, MemAddr addr);
+
+//! Returns the size of the map of a heap
+uint16_t os_getMapSize(Heap const* heap);
+
+//! Returns the size of the use area of a heap
+uint16_t os_getUseSize(Heap const* heap);
+
+//! Returns the first address of the map of a heap
+MemAddr os_getMapStart(Heap const* heap);
+
+//! Returns the first address of the use area of a heap
+MemAddr os_getUseStart(Heap const* heap);
+
+//! Changes the allocation strategy of a heap
+void os_setAllocationStrategy(Heap* heap, AllocStrategy allocStrat);
+
+//! Returns the allocation strategy of a heap
+AllocStrategy os_getAllocationStrategy(Heap const* heap);
+
+//! Returns the size of a cached size class
+uint8_t os_getCacheClassSize(uint8_t cls);
+
+//! Returns how often a request of a size class was served from a cache
+uint16_t os_getCacheHits(Heap const* heap, uint8_t cls);
+
+//! Returns how often a cache of a size class had to be refilled
+uint16_t os_getCacheMisses(Heap const* heap, uint8_t cls);
+
+//! Returns how many chunks of a size class are cached by all processes
+uint16_t os_getCachedChunks(Heap const* heap, uint8_t cls);
+
+//! Allocates a chunk the compactor may move, returns MEM_INVALID_HANDLE on failure
+MemHandle os_hmalloc(Heap* heap, uint16_t size);
+
+//! Pins the chunk of a handle and returns its current address
+MemAddr os_hlock(Heap* heap, MemHandle handle);
+
+//! Releases a pin of the chunk of a handle, so it may be moved again
+void os_hunlock(Heap* heap, MemHandle handle);
+
+//! Frees the chunk of a handle and the handle itself
+void os_hfree(Heap* heap, MemHandle handle);
+
+//! Moves at most one unlocked chunk towards the start of the heap, examining a bounded number of bytes
+bool os_compactStep(Heap* heap);
+
+//! Returns the number of chunks the compactor has moved
+uint16_t os_getCompactMoves(Heap const* heap);
+
+//! Returns the largest free block when the compactor last started moving chunks
+uint16_t os_getCompactLargestBefore(Heap const* heap);
+
+#endif
@@ -0,0 +1,533 @@
+#include "os_memory_strategies.h"
+#include "os_memory.h"
+
+#include <stdbool.h>
+
+/*! \file
+ *
+ * The allocation strategies. Each one searches a heap for a run of free bytes
+ * that can hold the requested chunk and returns the first address of the
+ * region to use. Marking the region as used is left to os_malloc. All
+ * strategies must be called inside a critical section.
+ *
+ * First, next, best and worst fit scan the map. The TLSF strategy instead
+ * uses the free-list index of the heap: every maximal run of at least
+ * MEM_FREE_BLOCK_MIN free bytes is a free block and sits in the list for its
+ * size class. Size classes are split in power-of-two first levels and
+ * MEM_TLSF_SL_COUNT second levels, and a bitmap per level tells which lists
+ * are non-empty. The links are stored in the free memory itself:
+ *
+ *   offset 0: size, offset 2: next block, offset 4: previous block,
+ *   last two bytes: size again (footer)
+ *
+ * Shorter free runs are not listed. As they are shorter than
+ * MEM_FREE_BLOCK_MIN, they can always be measured on the map in a bounded
+ * number of steps. In the tag layout every free region is a block of at
+ * least MEM_FREE_BLOCK_MIN bytes whose header is the free-list header, so all
+ * of them are listed. The index is kept up to date by os_malloc and os_free
+ * for every strategy, so the strategy may be changed at any time.
+ *
+ */
+
+/*!
+ *  Returns the number of free bytes starting at the passed address.
+ *
+ *  \param heap The heap to examine.
+ *  \param addr The first address of the run (in the use area).
+ *  \return The length of the run of free bytes, 0 if addr is in use.
+ */
+static uint16_t os_getFreeRunLength(Heap const* heap, MemAddr addr) {
+    MemAddr const end = heap->useStart + heap->useSize;
+    MemAddr runEnd = addr;
+    while (runEnd < end && os_getMapEntry(heap, runEnd) == MEM_MAP_FREE) {
+        runEnd++;
+    }
+    return runEnd - addr;
+}
+
+/*!
+ *  Returns the index of the highest set bit. At most 15 iterations.
+ *
+ *  \param value The value to examine (not 0).
+ *  \return The index of the highest set bit.
+ */
+static uint8_t os_getHighestBit(uint16_t value) {
+    uint8_t bit = 15;
+    while (!(value & 0x8000)) {
+        value <<= 1;
+        bit--;
+    }
+    return bit;
+}
+
+/*!
+ *  Returns the index of the lowest set bit. At most 15 iterations.
+ *
+ *  \param value The value to examine (not 0).
+ *  \return The index of the lowest set bit.
+ */
+static uint8_t os_getLowestBit(uint16_t value) {
+    uint8_t bit = 0;
+    while (!(value & 1)) {
+        value >>= 1;
+        bit++;
+    }
+    return bit;
+}
+
+/*!
+ *  Computes the free list a block of the passed size belongs to.
+ *
+ *  \param size The size of the block (at least MEM_FREE_BLOCK_MIN).
+ *  \param fl Where to store the first level.
+ *  \param sl Where to store the second level.
+ */
+static void os_getFreeListIndex(uint16_t size, uint8_t* fl, uint8_t* sl) {
+    uint8_t const bit = os_getHighestBit(size);
+    *fl = bit - MEM_TLSF_FL_MIN;
+    *sl = (size >> (bit - MEM_TLSF_SL_BITS)) & (MEM_TLSF_SL_COUNT - 1);
+}
+
+/*!
+ *  Adds a free block to its free list and writes its header and footer.
+ *
+ *  \param heap The heap of the block.
+ *  \param addr The first address of the block.
+ *  \param size The size of the block (at least MEM_FREE_BLOCK_MIN).
+ */
+static void os_freeListInsert(Heap* heap, MemAddr addr, uint16_t size) {
+    uint8_t fl, sl;
+    os_getFreeListIndex(size, &fl, &sl);
+    MemAddr const next = heap->freeLists[fl][sl];
+
+    os_writeHeapWord(heap, addr, size);
+    os_writeHeapWord(heap, addr + 2, next);
+    os_writeHeapWord(heap, addr + 4, 0);
+    os_writeHeapWord(heap, addr + size - 2, size);
+    if (next) {
+        os_writeHeapWord(heap, next + 4, addr);
+    }
+
+    heap->freeLists[fl][sl] = addr;
+    heap->freeSecondLevels[fl] |= 1 << sl;
+    heap->freeFirstLevels |= 1 << fl;
+}
+
+/*!
+ *  Removes a free block from its free list.
+ *
+ *  \param heap The heap of the block.
+ *  \param addr The first address of the block.
+ */
+static void os_freeListRemove(Heap* heap, MemAddr addr) {
+    MemAddr const next = os_readHeapWord(heap, addr + 2);
+    MemAddr const prev = os_readHeapWord(heap, addr + 4);
+
+    if (next) {
+        os_writeHeapWord(heap, next + 4, prev);
+    }
+    if (prev) {
+        os_writeHeapWord(heap, prev + 2, next);
+    } else {
+        uint8_t fl, sl;
+        os_getFreeListIndex(os_readHeapWord(heap, addr), &fl, &sl);
+        heap->freeLists[fl][sl] = next;
+        if (!next) {
+            heap->freeSecondLevels[fl] &= ~(1 << sl);
+            if (!heap->freeSecondLevels[fl]) {
+                heap->freeFirstLevels &= ~(1 << fl);
+            }
+        }
+    }
+}
+
+/*!
+ *  Returns the length of the free run starting at the passed address. Runs
+ *  of at least MEM_FREE_BLOCK_MIN bytes are free blocks, their length is
+ *  taken from the header, so at most MEM_FREE_BLOCK_MIN map entries are read.
+ *
+ *  \param heap The heap to examine.
+ *  \param start The first address of the run.
+ *  \return The length of the run.
+ */
+uint16_t os_getFreeRunSize(Heap const* heap, MemAddr start) {
+    if (heap->layout == OS_MEM_LAYOUT_TAGS) {
+        uint16_t const tag = os_readHeapWord(heap, start);
+        return MEM_TAG_OWNER(tag) ? 0 : tag;
+    }
+
+    MemAddr const end = heap->useStart + heap->useSize;
+    MemAddr addr = start;
+    while (addr < end && addr - start < MEM_FREE_BLOCK_MIN && os_getMapEntry(heap, addr) == MEM_MAP_FREE) {
+        addr++;
+    }
+    if (addr - start == MEM_FREE_BLOCK_MIN) {
+        return os_readHeapWord(heap, start);
+    }
+    return addr - start;
+}
+
+/*!
+ *  Rebuilds the free-list index of a heap from its map. This takes time
+ *  linear in the size of the heap and is needed after the heap was
+ *  initialized or erased without going through os_free. A heap in the tag
+ *  layout has no map, so all its memory becomes one free block. The caches,
+ *  chunk lists and handles of all processes are emptied, as their chunks are
+ *  no longer allocated.
+ *
+ *  \param heap The heap to index.
+ */
+void os_freeListRebuild(Heap* heap) {
+    for (ProcessID pid = 0; pid < MAX_NUMBER_OF_PROCESSES; pid++) {
+        heap->ownedChunks[pid] = 0;
+        for (uint8_t cls = 0; cls < MEM_CACHE_CLASS_COUNT; cls++) {
+            heap->cache[pid][cls] = 0;
+            heap->cacheCount[pid][cls] = 0;
+        }
+    }
+
+    heap->freeFirstLevels = 0;
+    for (uint8_t fl = 0; fl < MEM_TLSF_FL_COUNT; fl++) {
+        heap->freeSecondLevels[fl] = 0;
+        for (uint8_t sl = 0; sl < MEM_TLSF_SL_COUNT; sl++) {
+            heap->freeLists[fl][sl] = 0;
+        }
+    }
+
+    for (uint8_t handle = 0; handle < MEM_HANDLE_COUNT; handle++) {
+        heap->handles[handle] = 0;
+        heap->handleLocks[handle] = 0;
+    }
+
+    heap->nextFitStart = heap->useStart;
+    heap->compactCursor = heap->useStart;
+    heap->compactMoving = false;
+    heap->compactSettled = true;
+
+    if (heap->layout == OS_MEM_LAYOUT_TAGS) {
+        if (heap->useSize >= MEM_FREE_BLOCK_MIN) {
+            os_freeListInsert(heap, heap->useStart, heap->useSize);
+        }
+        heap->compactLargestBefore = os_getLargestFreeBlock(heap);
+        return;
+    }
+
+    MemAddr const end = heap->useStart + heap->useSize;
+    MemAddr addr = heap->useStart;
+    while (addr < end) {
+        uint16_t const run = os_getFreeRunLength(heap, addr);
+        if (run >= MEM_FREE_BLOCK_MIN) {
+            os_freeListInsert(heap, addr, run);
+        }
+        addr += run ? run : 1;
+    }
+    heap->compactLargestBefore = os_getLargestFreeBlock(heap);
+}
+
+/*!
+ *  Updates the free-list index before the passed region is marked as used.
+ *  The free block the region is taken from is removed and the parts left
+ *  over in front of and behind the region are listed again. If the region
+ *  starts a free run (as with the TLSF strategy), this takes constant time.
+ *  In the tag layout the region always starts a free block. A rest too small
+ *  for a block of its own is added to the region.
+ *
+ *  \param heap The heap of the region.
+ *  \param addr The first address of the region (must be free).
+ *  \param size The size of the region.
+ *  \return The size of the region actually taken.
+ */
+uint16_t os_freeListTake(Heap* heap, MemAddr addr, uint16_t size) {
+    if (heap->layout == OS_MEM_LAYOUT_TAGS) {
+        uint16_t const block = os_readHeapWord(heap, addr);
+        os_freeListRemove(heap, addr);
+        if (block - size < MEM_FREE_BLOCK_MIN) {
+            return block;
+        }
+        os_freeListInsert(heap, addr + size, block - size);
+        return size;
+    }
+
+    MemAddr start = addr;
+    while (start > heap->useStart && os_getMapEntry(heap, start - 1) == MEM_MAP_FREE) {
+        start--;
+    }
+    uint16_t const run = os_getFreeRunSize(heap, start);
+    if (run >= MEM_FREE_BLOCK_MIN) {
+        os_freeListRemove(heap, start);
+    }
+
+    if (addr - start >= MEM_FREE_BLOCK_MIN) {
+        os_freeListInsert(heap, start, addr - start);
+    }
+    uint16_t const rest = start + run - (addr + size);
+    if (rest >= MEM_FREE_BLOCK_MIN) {
+        os_freeListInsert(heap, addr + size, rest);
+    }
+    return size;
+}
+
+/*!
+ *  Merges a free run of the map layout with the free runs next to it and
+ *  removes the merged free blocks from the index.
+ *
+ *  \param heap The heap of the run.
+ *  \param startInOut The first address of the run, set to that of the merged run.
+ *  \param endInOut The address behind the run, set to that of the merged run.
+ */
+static void os_freeListMergeRun(Heap* heap, MemAddr* startInOut, MemAddr* endInOut) {
+    MemAddr start = *startInOut;
+    MemAddr end = *endInOut;
+
+    // Free run in front: measure it on the map or, if it is a block, use its footer
+    if (start > heap->useStart && os_getMapEntry(heap, start - 1) == MEM_MAP_FREE) {
+        MemAddr prev = start - 1;
+        while (start - prev < MEM_FREE_BLOCK_MIN && prev > heap->useStart
+               && os_getMapEntry(heap, prev - 1) == MEM_MAP_FREE) {
+            prev--;
+        }
+        if (start - prev >= MEM_FREE_BLOCK_MIN) {
+            prev = start - os_readHeapWord(heap, start - 2);
+            os_freeListRemove(heap, prev);
+        }
+        start = prev;
+    }
+
+    // Free run behind
+    if (end < heap->useStart + heap->useSize && os_getMapEntry(heap, end) == MEM_MAP_FREE) {
+        uint16_t const run = os_getFreeRunSize(heap, end);
+        if (run >= MEM_FREE_BLOCK_MIN) {
+            os_freeListRemove(heap, end);
+        }
+        end += run;
+    }
+
+    *startInOut = start;
+    *endInOut = end;
+}
+
+/*!
+ *  Updates the free-list index after the passed region was marked as free.
+ *  The region is merged with the free runs next to it, which takes constant
+ *  time. In the tag layout the region is a whole block, its header and
+ *  footer are rewritten as those of a free block.
+ *
+ *  \param heap The heap of the region.
+ *  \param addr The first address of the region.
+ *  \param size The size of the region.
+ *  \return The first address of the merged free region.
+ */
+MemAddr os_freeListRelease(Heap* heap, MemAddr addr, uint16_t size) {
+    MemAddr start = addr;
+    MemAddr end = addr + size;
+
+    if (heap->layout == OS_MEM_LAYOUT_TAGS) {
+        // Neighbouring free blocks are found through the footer in front and the header behind
+        if (start > heap->useStart) {
+            uint16_t const tag = os_readHeapWord(heap, start - 2);
+            if (!MEM_TAG_OWNER(tag)) {
+                start -= tag;
+                os_freeListRemove(heap, start);
+                // The header is now inside the free block, clear it so the chunk cannot be freed twice
+                os_writeHeapWord(heap, addr, 0);
+            }
+        }
+        if (end < heap->useStart + heap->useSize) {
+            uint16_t const tag = os_readHeapWord(heap, end);
+            if (!MEM_TAG_OWNER(tag)) {
+                os_freeListRemove(heap, end);
+                end += tag;
+            }
+        }
+    } else {
+        os_freeListMergeRun(heap, &start, &end);
+    }
+
+    if (end - start >= MEM_FREE_BLOCK_MIN) {
+        os_freeListInsert(heap, start, end - start);
+    }
+
+    // Next fit and the compactor have to continue at the start of a region
+    if (heap->nextFitStart > start && heap->nextFitStart < end) {
+        heap->nextFitStart = start;
+    }
+    if (heap->compactCursor > start && heap->compactCursor < end) {
+        heap->compactCursor = start;
+    }
+    return start;
+}
+
+/*!
+ *  Steps to the next region of a heap. In the map layout a region is a free
+ *  run or a single used byte, in the tag layout it is a block.
+ *
+ *  \param heap The heap to examine.
+ *  \param addr The first address of the region.
+ *  \param freeSize Where to store the size of the region if it is free, 0 otherwise.
+ *  \return The first address of the next region.
+ */
+static MemAddr os_getNextRegion(Heap const* heap, MemAddr addr, uint16_t* freeSize) {
+    if (heap->layout == OS_MEM_LAYOUT_TAGS) {
+        uint16_t const tag = os_readHeapWord(heap, addr);
+        *freeSize = MEM_TAG_OWNER(tag) ? 0 : tag;
+        return addr + MEM_TAG_SIZE(tag);
+    }
+
+    *freeSize = os_getFreeRunLength(heap, addr);
+    return addr + (*freeSize ? *freeSize : 1);
+}
+
+/*!
+ *  Searches for the first run of free bytes that starts in the passed range
+ *  and is large enough. A run may extend beyond the end of the range.
+ *
+ *  \param heap The heap to examine.
+ *  \param size The number of bytes needed.
+ *  \param from The first address to search from.
+ *  \param to The address where no more runs may start.
+ *  \return The first address of the run or 0 if there is none.
+ */
+static MemAddr os_findFirstFit(Heap const* heap, uint16_t size, MemAddr from, MemAddr to) {
+    MemAddr addr = from;
+    while (addr < to) {
+        uint16_t run;
+        MemAddr const next = os_getNextRegion(heap, addr, &run);
+        if (run >= size) {
+            return addr;
+        }
+        addr = next;
+    }
+    return 0;
+}
+
+/*!
+ *  Searches for the smallest or the largest run of free bytes that is large
+ *  enough. On a tie the run with the lowest address is taken.
+ *
+ *  \param heap The heap to examine.
+ *  \param size The number of bytes needed.
+ *  \param largest True to search for the largest run, false for the smallest.
+ *  \return The first address of the run or 0 if there is none.
+ */
+static MemAddr os_findExtremeFit(Heap const* heap, uint16_t size, bool largest) {
+    MemAddr const end = heap->useStart + heap->useSize;
+    MemAddr found = 0;
+    uint16_t foundRun = 0;
+    MemAddr addr = heap->useStart;
+    while (addr < end) {
+        uint16_t run;
+        MemAddr const next = os_getNextRegion(heap, addr, &run);
+        if (run >= size && (!found || (largest ? run > foundRun : run < foundRun))) {
+            found = addr;
+            foundRun = run;
+        }
+        addr = next;
+    }
+    return found;
+}
+
+/*!
+ *  Takes the first region that is large enough, searching from the start of
+ *  the use area.
+ *
+ *  \param heap The heap to allocate from.
+ *  \param size The number of bytes needed.
+ *  \return The first address of the region or 0 if there is none.
+ */
+MemAddr os_Memory_FirstFit(Heap* heap, uint16_t size) {
+    return os_findFirstFit(heap, size, heap->useStart, heap->useStart + heap->useSize);
+}
+
+/*!
+ *  Takes the first region that is large enough, searching from behind the
+ *  previous allocation and wrapping around at the end of the use area.
+ *
+ *  \param heap The heap to allocate from.
+ *  \param size The number of bytes needed.
+ *  \return The first address of the region or 0 if there is none.
+ */
+MemAddr os_Memory_NextFit(Heap* heap, uint16_t size) {
+    MemAddr const end = heap->useStart + heap->useSize;
+    MemAddr found = os_findFirstFit(heap, size, heap->nextFitStart, end);
+    if (!found) {
+        found = os_findFirstFit(heap, size, heap->useStart, heap->nextFitStart);
+    }
+    return found;
+}
+
+/*!
+ *  Takes the smallest region that is large enough.
+ *
+ *  \param heap The heap to allocate from.
+ *  \param size The number of bytes needed.
+ *  \return The first address of the region or 0 if there is none.
+ */
+MemAddr os_Memory_BestFit(Heap* heap, uint16_t size) {
+    return os_findExtremeFit(heap, size, false);
+}
+
+/*!
+ *  Takes the largest region.
+ *
+ *  \param heap The heap to allocate from.
+ *  \param size The number of bytes needed.
+ *  \return The first address of the region or 0 if there is none.
+ */
+MemAddr os_Memory_WorstFit(Heap* heap, uint16_t size) {
+    return os_findExtremeFit(heap, size, true);
+}
+
+/*!
+ *  Takes a free block from the first non-empty free list whose blocks are
+ *  all large enough (good fit). The request is rounded up to the next list
+ *  boundary, the bitmaps then yield that list in constant time.
+ *
+ *  \param heap The heap to allocate from.
+ *  \param size The number of bytes needed.
+ *  \return The first address of the region or 0 if there is none.
+ */
+MemAddr os_Memory_TLSF(Heap* heap, uint16_t size) {
+    uint16_t search = (size < MEM_FREE_BLOCK_MIN) ? MEM_FREE_BLOCK_MIN : size;
+    uint16_t const round = (1 << (os_getHighestBit(search) - MEM_TLSF_SL_BITS)) - 1;
+    if (search > UINT16_MAX - round) {
+        return 0;
+    }
+    search += round;
+
+    uint8_t fl, sl;
+    os_getFreeListIndex(search, &fl, &sl);
+    uint8_t secondLevels = heap->freeSecondLevels[fl] & (uint8_t)(0xFF << sl);
+    if (!secondLevels) {
+        uint16_t const firstLevels = heap->freeFirstLevels & (uint16_t)(0xFFFF << (fl + 1));
+        if (!firstLevels) {
+            return 0;
+        }
+        fl = os_getLowestBit(firstLevels);
+        secondLevels = heap->freeSecondLevels[fl];
+    }
+    return heap->freeLists[fl][os_getLowestBit(secondLevels)];
+}
+
+/*!
+ *  Returns the size of the largest free block of a heap. Only the free list
+ *  of the highest non-empty size class is searched.
+ *
+ *  \param heap The heap to examine.
+ *  \return The size of the largest free block in bytes, 0 if there is none.
+ */
+uint16_t os_getLargestFreeBlock(Heap const* heap) {
+    if (!heap->freeFirstLevels) {
+        return 0;
+    }
+
+    uint8_t const fl = os_getHighestBit(heap->freeFirstLevels);
+    uint8_t const sl = os_getHighestBit(heap->freeSecondLevels[fl]);
+    uint16_t largest = 0;
+    for (MemAddr block = heap->freeLists[fl][sl]; block; block = os_readHeapWord(heap, block + 2)) {
+        uint16_t const size = os_readHeapWord(heap, block);
+        if (size > largest) {
+            largest = size;
+        }
+    }
+    return largest;
+}
@@ -0,0 +1,53 @@
+/*! \file
+ *  \brief Allocation strategies of the memory module.
+ *
+ *  Contains the strategies that search a heap for a free region to place a
+ *  new chunk in, and the free-list index the TLSF strategy works on.
+ */
+
+#ifndef _OS_MEMORY_STRATEGIES_H
+#define _OS_MEMORY_STRATEGIES_H
+
+#include <stdint.h>
+
+#include "os_memheap_drivers.h"
+
+#if MEM_TLSF_FL_MIN < MEM_TLSF_SL_BITS || (1 << MEM_TLSF_FL_MIN) != MEM_FREE_BLOCK_MIN
+    #error The free-list index needs MEM_FREE_BLOCK_MIN == 2^MEM_TLSF_FL_MIN and at least 2^MEM_TLSF_SL_BITS bytes per block
+#endif
+
+//----------------------------------------------------------------------------
+// Function headers
+//----------------------------------------------------------------------------
+
+//! First fit strategy
+MemAddr os_Memory_FirstFit(Heap* heap, uint16_t size);
+
+//! Next fit strategy
+MemAddr os_Memory_NextFit(Heap* heap, uint16_t size);
+
+//! Best fit strategy
+MemAddr os_Memory_BestFit(Heap* heap, uint16_t size);
+
+//! Worst fit strategy
+MemAddr os_Memory_WorstFit(Heap* heap, uint16_t size);
+
+//! TLSF strategy (segregated free lists, constant time)
+MemAddr os_Memory_TLSF(Heap* heap, uint16_t size);
+
+//! Rebuilds the free-list index of a heap from its map
+void os_freeListRebuild(Heap* heap);
+
+//! Updates the free-list index before a free region is marked as used, returns the size taken
+uint16_t os_freeListTake(Heap* heap, MemAddr addr, uint16_t size);
+
+//! Updates the free-list index after a region was marked as free, returns the start of the merged region
+MemAddr os_freeListRelease(Heap* heap, MemAddr addr, uint16_t size);
+
+//! Returns the length of the free run starting at an address in a bounded number of steps
+uint16_t os_getFreeRunSize(Heap const* heap, MemAddr start);
+
+//! Returns the size of the largest free block of a heap
+uint16_t os_getLargestFreeBlock(Heap const* heap);
+
+#endif
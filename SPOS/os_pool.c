@@ -0,0 +1,248 @@
+#include "os_pool.h"
+#include "os_scheduler.h"
+#include "os_core.h"
+
+#include <avr/interrupt.h>
+
+/*! \file
+ *
+ * Fixed-size block pools with an intrusive free list. Taking and returning a
+ * block only touches the head of the list, so interrupts are disabled for a
+ * few cycles and both operations are safe from ISRs. The byte in front of
+ * every block records its owner, so blocks of a terminated process can be
+ * found and returned without any further bookkeeping.
+ *
+ */
+
+//! All pools that ever handed out a block, so os_poolFreeProcessBlocks can find them.
+static Pool* os_pools = NULL;
+
+//! Distance between two blocks of a pool
+#define os_poolStride(POOL) ((uint16_t)(POOL)->blockSize + 1)
+
+//! Reads or writes the link to the next free block stored in a free block
+#define os_poolLink(BLOCK) (*(uint8_t**)(BLOCK))
+
+/*!
+ *  Takes a block from the pool. Blocks that were returned are reused first,
+ *  then the blocks that were never handed out. The first block handed out
+ *  enters the pool into the list of pools. Must be called with interrupts
+ *  disabled.
+ *
+ *  \param pool The pool to take a block from.
+ *  \param owner The owner recorded for the block.
+ *  \return The block or NULL if the pool is exhausted.
+ */
+static uint8_t* os_poolTake(Pool* pool, ProcessID owner) {
+    uint8_t* block = pool->freeList;
+
+    if (block) {
+        pool->freeList = os_poolLink(block);
+    } else if (pool->fresh < pool->count) {
+        if (!pool->fresh) {
+            pool->next = os_pools;
+            os_pools = pool;
+        }
+        block = pool->storage + pool->fresh * os_poolStride(pool) + 1;
+        pool->fresh++;
+    } else {
+        return NULL;
+    }
+
+    block[-1] = owner;
+    if (--pool->available < pool->minAvailable) {
+        pool->minAvailable = pool->available;
+    }
+    return block;
+}
+
+/*!
+ *  Puts a block back into the free list of its pool. Must be called with
+ *  interrupts disabled.
+ *
+ *  \param pool The pool the block belongs to.
+ *  \param block The block to return.
+ */
+static void os_poolGive(Pool* pool, uint8_t* block) {
+    block[-1] = POOL_OWNER_FREE;
+    os_poolLink(block) = pool->freeList;
+    pool->freeList = block;
+    pool->available++;
+}
+
+/*!
+ *  Checks that the address was handed out by the pool and is still allocated.
+ *  Must be called with interrupts disabled.
+ *
+ *  \param pool The pool the block should belong to.
+ *  \param block The address to check.
+ *  \return True if the block is allocated, otherwise an error was reported.
+ */
+static bool os_poolCheck(Pool const* pool, uint8_t const* block) {
+    if (block <= pool->storage || block >= pool->storage + pool->fresh * os_poolStride(pool)) {
+        os_error("Block nicht aus Pool");
+        return false;
+    }
+    if (block[-1] == POOL_OWNER_FREE) {
+        os_error("Poolblock schon frei");
+        return false;
+    }
+    return true;
+}
+
+/*!
+ *  Initializes a pool with storage provided by the caller. Use the POOL macro
+ *  instead if the pool can be allocated statically. Calling this for a pool
+ *  that is in use frees all of its blocks.
+ *
+ *  \param pool The pool to initialize.
+ *  \param storage The storage for the blocks. Must hold at least
+ *         POOL_STORAGE_SIZE(blockSize, count) bytes.
+ *  \param blockSize The usable size of every block, at least the size of a pointer.
+ *  \param count The number of blocks.
+ *  \return True on success, false if the block size or count is invalid.
+ */
+bool os_poolCreate(Pool* pool, uint8_t* storage, uint8_t blockSize, uint8_t count) {
+    if (blockSize < sizeof(uint8_t*) || !count) {
+        return false;
+    }
+
+    uint8_t const sreg = SREG;
+    cli();
+
+    // A pool that handed out blocks is entered again once it does so
+    Pool** link = &os_pools;
+    while (*link && *link != pool) {
+        link = &(*link)->next;
+    }
+    if (*link) {
+        *link = pool->next;
+    }
+
+    pool->storage = storage;
+    pool->blockSize = blockSize;
+    pool->count = count;
+    pool->fresh = 0;
+    pool->freeList = NULL;
+    pool->available = count;
+    pool->minAvailable = count;
+    pool->next = NULL;
+
+    SREG = sreg;
+    return true;
+}
+
+/*!
+ *  Allocates a block that is owned by the current process. If the process
+ *  terminates while holding the block, it is returned automatically. This
+ *  never blocks.
+ *
+ *  \param pool The pool to allocate from.
+ *  \return The block or NULL if the pool is exhausted.
+ */
+void* os_poolAlloc(Pool* pool) {
+    uint8_t const sreg = SREG;
+    cli();
+    uint8_t* const block = os_poolTake(pool, os_getCurrentProc());
+    SREG = sreg;
+    return block;
+}
+
+/*!
+ *  Allocates a block without owner. This is meant for ISRs, which must not
+ *  charge the block to the process they interrupted. The process that
+ *  receives the block may take it over by os_poolAdopt or free it. This never
+ *  blocks.
+ *
+ *  \param pool The pool to allocate from.
+ *  \return The block or NULL if the pool is exhausted.
+ */
+void* os_poolAllocISR(Pool* pool) {
+    uint8_t const sreg = SREG;
+    cli();
+    uint8_t* const block = os_poolTake(pool, POOL_OWNER_NONE);
+    SREG = sreg;
+    return block;
+}
+
+/*!
+ *  Makes the current process the owner of an allocated block, so it is
+ *  returned if the process terminates. This is used for blocks that were
+ *  allocated by an ISR or another process and handed over.
+ *
+ *  \param pool The pool the block belongs to.
+ *  \param block The block to take over.
+ */
+void os_poolAdopt(Pool* pool, void* block) {
+    uint8_t const sreg = SREG;
+    cli();
+    if (os_poolCheck(pool, block)) {
+        ((uint8_t*)block)[-1] = os_getCurrentProc();
+    }
+    SREG = sreg;
+}
+
+/*!
+ *  Returns a block to its pool. Any process or ISR may free a block,
+ *  regardless of its owner.
+ *
+ *  \param pool The pool the block belongs to.
+ *  \param block The block to free.
+ */
+void os_poolFree(Pool* pool, void* block) {
+    uint8_t const sreg = SREG;
+    cli();
+    if (os_poolCheck(pool, block)) {
+        os_poolGive(pool, block);
+    }
+    SREG = sreg;
+}
+
+/*!
+ *  Returns all blocks owned by the passed process to their pools. This is
+ *  used by os_kill. Interrupts are only disabled for one block at a time, so
+ *  ISRs keep running while the pools are searched.
+ *
+ *  \param pid The process whose blocks are returned.
+ */
+void os_poolFreeProcessBlocks(ProcessID pid) {
+    uint8_t sreg = SREG;
+    cli();
+    Pool* pool = os_pools;
+    SREG = sreg;
+
+    for (; pool; pool = pool->next) {
+        uint8_t* block = pool->storage + 1;
+        for (uint8_t i = 0; i < pool->fresh; i++, block += os_poolStride(pool)) {
+            sreg = SREG;
+            cli();
+            if (block[-1] == pid) {
+                os_poolGive(pool, block);
+            }
+            SREG = sreg;
+        }
+    }
+}
+
+/*!
+ *  Returns the number of blocks that can currently be allocated. As ISRs may
+ *  allocate and free concurrently, this is only a snapshot.
+ *
+ *  \param pool The pool to examine.
+ *  \return The number of available blocks.
+ */
+uint8_t os_poolAvailable(Pool const* pool) {
+    return pool->available;
+}
+
+/*!
+ *  Returns the lowest number of available blocks since the pool was created.
+ *  This shows how close the pool came to being exhausted and helps choosing
+ *  its size.
+ *
+ *  \param pool The pool to examine.
+ *  \return The low-water mark of available blocks.
+ */
+uint8_t os_poolMinAvailable(Pool const* pool) {
+    return pool->minAvailable;
+}
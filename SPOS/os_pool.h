@@ -0,0 +1,118 @@
+/*! \file
+ *  \brief Fixed-size block pools.
+ *
+ *  Contains static memory pools that hand out blocks of one size in O(1).
+ *  Unlike the heaps, allocating and freeing is safe from ISRs, so they suit
+ *  data produced in interrupts (samples, input events).
+ */
+
+#ifndef _OS_POOL_H
+#define _OS_POOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "defines.h"
+#include "os_scheduler.h"
+
+//----------------------------------------------------------------------------
+// Types
+//----------------------------------------------------------------------------
+
+//! Owner of a block that is in the free list
+#define POOL_OWNER_FREE     INVALID_PROCESS
+
+//! Owner of a block allocated by an ISR. Such blocks are never reclaimed.
+#define POOL_OWNER_NONE     (INVALID_PROCESS - 1)
+
+//! Number of bytes needed to store COUNT blocks of BLOCK_SIZE bytes (including the owner bytes)
+#define POOL_STORAGE_SIZE(BLOCK_SIZE, COUNT) ((uint16_t)((BLOCK_SIZE) + 1) * (COUNT))
+
+/*!
+ *  The state of a block pool.
+ *  Every block is preceded by one byte holding its owner. A free block stores
+ *  the address of the next free block in its first bytes, so the free list
+ *  needs no memory of its own. Blocks that were never handed out are not in the
+ *  free list, they are taken in order starting at index fresh. Hence, a pool
+ *  needs no initialization pass and can be set up statically.
+ */
+typedef struct Pool {
+    //! The storage of the pool, POOL_STORAGE_SIZE(blockSize, count) bytes.
+    uint8_t* storage;
+
+    //! Usable size of a block in bytes.
+    uint8_t blockSize;
+
+    //! Number of blocks in the pool.
+    uint8_t count;
+
+    //! Number of blocks that were handed out at least once.
+    uint8_t volatile fresh;
+
+    //! The first free block or NULL.
+    uint8_t* volatile freeList;
+
+    //! Number of blocks that are currently not allocated.
+    uint8_t volatile available;
+
+    //! Lowest value available ever had since the pool was created.
+    uint8_t volatile minAvailable;
+
+    //! The next pool that was handed out blocks, used to reclaim blocks of terminated processes.
+    struct Pool* next;
+} Pool;
+
+/*!
+ *  Defines a statically allocated pool with the given name, block size and
+ *  number of blocks. A block must be able to hold a pointer and both values
+ *  must fit into a byte, which is checked at compile time.
+ *  Use this macro in this fashion:
+ *
+ *    POOL(samplePool, 8, 16);
+ *    ...
+ *    uint8_t* sample = os_poolAllocISR(&samplePool);
+ */
+#define POOL(NAME, BLOCK_SIZE, COUNT) \
+    typedef char NAME##_block_size_and_count_must_be_in_range \
+        [((BLOCK_SIZE) >= sizeof(uint8_t*) && (BLOCK_SIZE) <= 255 && (COUNT) >= 1 && (COUNT) <= 255) ? 1 : -1]; \
+    static uint8_t NAME##_storage[POOL_STORAGE_SIZE(BLOCK_SIZE, COUNT)]; \
+    Pool NAME = { \
+        .storage = NAME##_storage, \
+        .blockSize = (BLOCK_SIZE), \
+        .count = (COUNT), \
+        .fresh = 0, \
+        .freeList = NULL, \
+        .available = (COUNT), \
+        .minAvailable = (COUNT), \
+        .next = NULL \
+    }
+
+//----------------------------------------------------------------------------
+// Function headers
+//----------------------------------------------------------------------------
+
+//! Initializes a pool with external storage, all blocks become free
+bool os_poolCreate(Pool* pool, uint8_t* storage, uint8_t blockSize, uint8_t count);
+
+//! Allocates a block owned by the current process (never blocks)
+void* os_poolAlloc(Pool* pool);
+
+//! Allocates a block without owner, for ISRs (never blocks)
+void* os_poolAllocISR(Pool* pool);
+
+//! Makes the current process the owner of a block, e.g. one passed on by an ISR
+void os_poolAdopt(Pool* pool, void* block);
+
+//! Returns a block to its pool (callable from ISRs)
+void os_poolFree(Pool* pool, void* block);
+
+//! Returns all blocks owned by a process to their pools (used on termination)
+void os_poolFreeProcessBlocks(ProcessID pid);
+
+//! Returns the number of blocks that can currently be allocated
+uint8_t os_poolAvailable(Pool const* pool);
+
+//! Returns the lowest number of available blocks since the pool was created
+uint8_t os_poolMinAvailable(Pool const* pool);
+
+#endif
@@ -0,0 +1,133 @@
+#include "os_post.h"
+#include "os_scheduler.h"
+#include "os_core.h"
+
+#include <avr/interrupt.h>
+
+/*! \file
+ *
+ * Run-to-completion task queue in the style of TinyOS 2. Processes and ISRs
+ * post functions with os_post, a kernel worker process runs them one after
+ * another in FIFO order and blocks while the queue is empty.
+ * Like in TinyOS, a function is queued at most once: posting a function that
+ * is still waiting in the queue is coalesced with the pending post. Once the
+ * worker has taken it out of the queue, it may be posted again, so a function
+ * can repost itself.
+ *
+ * The queue uses free running 8-bit counters like os_deferred. Posting masks
+ * interrupts for the scan over the pending entries, which is bounded by
+ * POST_QUEUE_SIZE.
+ *
+ * The worker is a system process: the task manager neither offers its
+ * program for starting nor lets the user kill it.
+ *
+ */
+
+#if POST_SUPPORT
+
+#if (POST_QUEUE_SIZE & (POST_QUEUE_SIZE - 1)) || (POST_QUEUE_SIZE > 128)
+    #error "POST_QUEUE_SIZE must be a power of two up to 128"
+#endif
+
+#if POST_WORKER_STACK_SIZE < STACK_SIZE_PROC_MIN || POST_WORKER_STACK_SIZE > STACK_SIZE_PROCS
+    #error "POST_WORKER_STACK_SIZE must be between STACK_SIZE_PROC_MIN and STACK_SIZE_PROCS"
+#endif
+
+//! The posted functions.
+static PostedTask* os_postQueue[POST_QUEUE_SIZE];
+
+//! Number of functions ever posted (modulo 256).
+static uint8_t volatile os_postHead;
+
+//! Number of functions ever taken by the worker (modulo 256).
+static uint8_t volatile os_postTail;
+
+//! The worker waiting for posted functions.
+static WaitQueue os_postWaiting;
+
+//! The program of the worker process.
+static ProgramID os_postProgram = INVALID_PROGRAM;
+
+/*!
+ *  Posts a function. It is run by the worker process after all functions
+ *  posted before. If the function is already waiting in the queue, the post
+ *  is coalesced with the pending one. This may be called from processes,
+ *  ISRs and posted functions.
+ *
+ *  \param task The function to run.
+ *  \return True if the function is queued (now or already), false if the
+ *          queue is full.
+ */
+bool os_post(PostedTask* task) {
+    uint8_t const sreg = SREG;
+    cli();
+
+    uint8_t const head = os_postHead;
+    bool queued = false;
+    for (uint8_t i = os_postTail; i != head; i++) {
+        if (os_postQueue[i & (POST_QUEUE_SIZE - 1)] == task) {
+            queued = true;
+            break;
+        }
+    }
+
+    if (!queued && (uint8_t)(head - os_postTail) < POST_QUEUE_SIZE) {
+        os_postQueue[head & (POST_QUEUE_SIZE - 1)] = task;
+        os_postHead = head + 1;
+        os_waitQueueWakeOne(&os_postWaiting);
+        queued = true;
+    }
+
+    SREG = sreg;
+    return queued;
+}
+
+/*!
+ *  The program of the worker process. It takes the posted functions out of
+ *  the queue in FIFO order and runs each of them to completion.
+ *
+ *  \param arg Unused.
+ */
+static void os_postWorker(void* arg) {
+    while (1) {
+        uint8_t const sreg = SREG;
+        cli();
+
+        while (os_postHead == os_postTail) {
+            os_waitQueueBlock(&os_postWaiting);
+        }
+        uint8_t const tail = os_postTail;
+        PostedTask* const task = os_postQueue[tail & (POST_QUEUE_SIZE - 1)];
+        os_postTail = tail + 1;
+
+        SREG = sreg;
+        task();
+    }
+}
+
+/*!
+ *  Registers the worker program and starts the worker process with
+ *  POST_WORKER_PRIORITY and a stack of POST_WORKER_STACK_SIZE bytes. This
+ *  must be called after the idle process has been started, so the idle
+ *  process keeps pid 0.
+ */
+void os_initPost(void) {
+    os_postProgram = os_registerProgram(os_postWorker);
+    if (os_postProgram == INVALID_PROGRAM
+        || !os_setProgramStackSize(os_postProgram, POST_WORKER_STACK_SIZE)
+        || os_exec(os_postProgram, POST_WORKER_PRIORITY) == INVALID_PROCESS) {
+        os_error("Post-Worker nicht gestartet");
+    }
+}
+
+/*!
+ *  Returns the program of the worker process, so the task manager can hide
+ *  it.
+ *
+ *  \return The program or INVALID_PROGRAM if the worker is not registered.
+ */
+ProgramID os_getPostWorkerProgram(void) {
+    return os_postProgram;
+}
+
+#endif
@@ -0,0 +1,43 @@
+/*! \file
+ *  \brief TinyOS-style task posting for the OS.
+ *
+ *  Contains a bounded queue of functions that are run one after another by
+ *  a kernel worker process. Posting a function is much cheaper than starting
+ *  a process for every event. It is only built with POST_SUPPORT, as the
+ *  worker takes a process slot and stack memory.
+ */
+
+#ifndef _OS_POST_H
+#define _OS_POST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "defines.h"
+#include "os_process.h"
+
+#if POST_SUPPORT
+
+//----------------------------------------------------------------------------
+// Types
+//----------------------------------------------------------------------------
+
+//! This is the type of a posted function (not the pointer to one!).
+typedef void (PostedTask)(void);
+
+//----------------------------------------------------------------------------
+// Function headers
+//----------------------------------------------------------------------------
+
+//! Posts a function to be run by the worker process (callable from ISRs)
+bool os_post(PostedTask* task);
+
+//! Starts the worker process (called by the scheduler on initialization)
+void os_initPost(void);
+
+//! Returns the program of the worker process or INVALID_PROGRAM
+ProgramID os_getPostWorkerProgram(void);
+
+#endif
+
+#endif
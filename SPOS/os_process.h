@@ -14,6 +14,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "defines.h"
+
 //! The type for the ID of a running process.
 typedef uint8_t ProcessID;
 
@@ -27,14 +29,28 @@ typedef uint8_t Priority;
 typedef uint16_t Age;
 
 //! The type for the checksum used to check stack consistency.
+#if STACK_CHECKSUM_ALGORITHM == STACK_CHECKSUM_FLETCHER
+typedef uint16_t StackChecksum;
+#else
 typedef uint8_t StackChecksum;
+#endif
+
+//! The size of a process stack in bytes.
+typedef uint16_t StackSize;
+
+//! The value a process reports when it terminates.
+typedef int16_t ExitCode;
+
+//! The exit code of a process that was killed.
+#define EXIT_CODE_KILLED (-1)
 
 //! Type for the state a specific process is currently in.
 typedef enum ProcessState {
     OS_PS_UNUSED,
     OS_PS_READY,
     OS_PS_RUNNING,
-    OS_PS_BLOCKED
+    OS_PS_BLOCKED,
+    OS_PS_SUSPENDED
 } ProcessState;
 
 //! A union that holds the current stack pointer of a given process.
@@ -46,6 +62,8 @@ typedef union StackPointer {
 
 /*!
  *  The struct that holds all information for a process.
+ *  The scheduler stores the process table as parallel arrays, this struct is
+ *  only used for snapshots of a single process (see os_getProcessSnapshot).
  *  Note that additional scheduling information (such as the current time-slice)
  *  are stored by the module that implements the actual scheduling strategies.
  */
@@ -54,11 +72,15 @@ typedef struct {
     StackPointer sp;
     ProgramID progID;
     Priority priority;
+    uint8_t criticalSectionCount;
+    uint16_t stackBottom;   //!< The highest address of the process stack
+    StackSize stackSize;    //!< The size of the process stack
+    StackChecksum checksum; //!< The stack checksum recorded when the process was switched out
 } Process;
 
 //! This is the type of a program function (not the pointer to one!).
-
-typedef void (Program)(void);
+//! The argument is the one passed to os_execWithArg (NULL for os_exec).
+typedef void (Program)(void* arg);
 
 //! Specifies if a program should be automatically executed on boot-up.
 typedef enum {
@@ -77,6 +99,15 @@ typedef enum {
  *  If you pass 'AUTOSTART', it will create a process for this program while
  *  initializing the scheduler. If you pass 'DONTSTART' instead, only the
  *  program will be registered (which you may execute manually).
+ *  Inside the program, the argument passed to os_execWithArg is available as
+ *  'arg' (it is NULL if the program was started by os_exec or on boot-up).
+ *  If the program function returns, the process terminates with exit code 0.
+ *  The index must be smaller than MAX_NUMBER_OF_PROGRAMS, which is checked at
+ *  compile time.
+ *  Optionally, the stack size of the program's processes can be passed as
+ *  third parameter in the form 'STACK = bytes'. Without it, processes get
+ *  STACK_SIZE_PROC bytes. The size must be a constant between
+ *  STACK_SIZE_PROC_MIN and STACK_SIZE_PROCS, which is checked at compile time.
  *  Use this macro in this fashion:
  *
  *    PROGRAM(3, AUTOSTART) {
@@ -84,18 +115,32 @@ typedef enum {
  *      bar();
  *      ...
  *    }
+ *
+ *    PROGRAM(4, DONTSTART, STACK = 96) {
+ *      ...
+ *    }
  */
-#define PROGRAM(INDEX, ON_START_DO) \
+#define PROGRAM(INDEX, ON_START_DO, ...) \
     void program_with_index_##INDEX##_defined_twice (void) {} \
+    typedef char program_index_##INDEX##_out_of_range[((INDEX) < MAX_NUMBER_OF_PROGRAMS) ? 1 : -1]; \
     Program prog##INDEX; \
     void registerProgram##INDEX(void) __attribute__ ((constructor)); \
     void registerProgram##INDEX(void) { \
         Program** os_getProgramSlot(ProgramID progId); \
         *(os_getProgramSlot(INDEX)) = prog##INDEX; \
-        extern uint16_t os_autostart;\
-        os_autostart |= (ON_START_DO == AUTOSTART) << (INDEX); \
+        extern uint8_t os_autostart[];\
+        os_autostart[(INDEX) / 8] |= (uint8_t) ((ON_START_DO == AUTOSTART) << ((INDEX) % 8)); \
+        bool os_setProgramStackSize(ProgramID programID, StackSize size); \
+        enum { STACK = 0 }; \
+        { \
+            enum { program_##INDEX##_default_stack, __VA_ARGS__ }; \
+            typedef char program_##INDEX##_stack_size_out_of_range[(!STACK || (STACK >= STACK_SIZE_PROC_MIN && STACK <= STACK_SIZE_PROCS)) ? 1 : -1] __attribute__((unused)); \
+            if (STACK) { \
+                os_setProgramStackSize(INDEX, STACK); \
+            } \
+        } \
     } \
-    void prog##INDEX(void)
+    void prog##INDEX(void* arg)
 
 //! Returns whether the passed process can be selected to run.
 bool os_isRunnable(Process const* process);
@@ -0,0 +1,147 @@
+#include "os_ringbuffer.h"
+#include "os_scheduler.h"
+
+#include <avr/interrupt.h>
+
+/*! \file
+ *
+ * Lock-free single-producer/single-consumer byte queue. The producer is
+ * typically an ISR (Timer0, ADC, UART, button sampling) and the consumer a
+ * process. Neither side has to enter a critical section. Only the blocking
+ * consumer disables interrupts for the few cycles needed to recheck the
+ * buffer and enqueue itself, so no wakeup gets lost.
+ *
+ */
+
+/*!
+ *  Compiler barrier. The data byte has to be in memory before the counter
+ *  that publishes it is written, and it must be read before the counter that
+ *  releases its slot is written.
+ */
+#define os_ringBufferBarrier() __asm__ volatile("" ::: "memory")
+
+/*!
+ *  Initializes a ring buffer with storage provided by the caller. Use the
+ *  RINGBUFFER macro instead if the buffer can be allocated statically.
+ *
+ *  \param buffer The ring buffer to initialize.
+ *  \param data The storage for the buffer. Must hold at least capacity bytes.
+ *  \param capacity The capacity of the buffer (a power of two, at most 128).
+ *  \return True on success, false if the capacity is invalid.
+ */
+bool os_ringBufferInit(RingBuffer* buffer, uint8_t* data, uint8_t capacity) {
+    if (!capacity || capacity > 128 || (capacity & (capacity - 1))) {
+        return false;
+    }
+
+    buffer->head = 0;
+    buffer->tail = 0;
+    buffer->mask = capacity - 1;
+    buffer->data = data;
+    buffer->waiting = 0;
+    return true;
+}
+
+/*!
+ *  Appends a byte to the buffer. This must only be called by the single
+ *  producer of the buffer. It never blocks and is safe to call from an ISR.
+ *  If the consumer is blocked waiting for data, it is woken up.
+ *
+ *  \param buffer The ring buffer to write to.
+ *  \param value The byte to append.
+ *  \return True on success, false if the buffer was full (the byte is dropped).
+ */
+bool os_ringBufferPut(RingBuffer* buffer, uint8_t value) {
+    uint8_t const head = buffer->head;
+
+    if ((uint8_t)(head - buffer->tail) > buffer->mask) {
+        return false;
+    }
+
+    buffer->data[head & buffer->mask] = value;
+    os_ringBufferBarrier();
+    buffer->head = head + 1;
+
+    if (buffer->waiting) {
+        os_waitQueueWakeAll(&buffer->waiting);
+    }
+    return true;
+}
+
+/*!
+ *  Removes the oldest byte from the buffer. This must only be called by the
+ *  single consumer of the buffer. It never blocks.
+ *
+ *  \param buffer The ring buffer to read from.
+ *  \param value Where to store the byte that was read.
+ *  \return True on success, false if the buffer was empty.
+ */
+bool os_ringBufferGet(RingBuffer* buffer, uint8_t* value) {
+    uint8_t const tail = buffer->tail;
+
+    if (buffer->head == tail) {
+        return false;
+    }
+
+    *value = buffer->data[tail & buffer->mask];
+    os_ringBufferBarrier();
+    buffer->tail = tail + 1;
+    return true;
+}
+
+/*!
+ *  Removes the oldest byte from the buffer. If the buffer is empty, the
+ *  calling process is blocked until the producer appends data. Hence, this
+ *  must only be called by the single consumer and never by an ISR or the
+ *  idle process.
+ *
+ *  \param buffer The ring buffer to read from.
+ *  \return The byte that was read.
+ */
+uint8_t os_ringBufferGetBlocking(RingBuffer* buffer) {
+    uint8_t value;
+
+    while (!os_ringBufferGet(buffer, &value)) {
+        // The producer cannot interfere between the check and the enqueue
+        uint8_t const sreg = SREG;
+        cli();
+        if (os_ringBufferIsEmpty(buffer)) {
+            os_waitQueueBlock(&buffer->waiting);
+        }
+        SREG = sreg;
+    }
+
+    return value;
+}
+
+/*!
+ *  Returns the number of bytes that are currently stored in the buffer.
+ *  Depending on the caller this is a lower (consumer) or upper (producer)
+ *  bound, as the other side may change it concurrently.
+ *
+ *  \param buffer The ring buffer to examine.
+ *  \return The number of bytes in the buffer.
+ */
+uint8_t os_ringBufferCount(RingBuffer const* buffer) {
+    return buffer->head - buffer->tail;
+}
+
+/*!
+ *  Checks whether the buffer is empty.
+ *
+ *  \param buffer The ring buffer to examine.
+ *  \return True if there is nothing to read.
+ */
+bool os_ringBufferIsEmpty(RingBuffer const* buffer) {
+    return buffer->head == buffer->tail;
+}
+
+/*!
+ *  Checks whether the buffer is full.
+ *
+ *  \param buffer The ring buffer to examine.
+ *  \return True if no byte can be appended.
+ */
+bool os_ringBufferIsFull(RingBuffer const* buffer) {
+    return os_ringBufferCount(buffer) > buffer->mask;
+}
@@ -0,0 +1,92 @@
+/*! \file
+ *  \brief Single-producer/single-consumer ring buffer.
+ *
+ *  Contains a byte queue that lets exactly one producer (e.g. an ISR) hand
+ *  data to exactly one consumer (e.g. a process) without disabling
+ *  interrupts or the scheduler.
+ */
+
+#ifndef _OS_RINGBUFFER_H
+#define _OS_RINGBUFFER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "os_scheduler.h"
+
+//----------------------------------------------------------------------------
+// Types
+//----------------------------------------------------------------------------
+
+/*!
+ *  The state of a ring buffer.
+ *  head and tail are free running 8-bit counters. Only the producer writes
+ *  head and only the consumer writes tail. As single byte accesses are atomic
+ *  on the AVR, no locking is needed. The capacity must be a power of two
+ *  (at most 128), so the counters can simply overflow and be masked.
+ */
+typedef struct RingBuffer {
+    //! Number of bytes ever written (modulo 256). Only changed by the producer.
+    uint8_t volatile head;
+
+    //! Number of bytes ever read (modulo 256). Only changed by the consumer.
+    uint8_t volatile tail;
+
+    //! Capacity - 1, used to map the counters to an index.
+    uint8_t mask;
+
+    //! The storage of the buffer.
+    uint8_t* data;
+
+    //! The consumer waiting for data (if any).
+    WaitQueue waiting;
+} RingBuffer;
+
+/*!
+ *  Defines a statically allocated ring buffer with the given name and
+ *  capacity. The capacity must be a power of two between 1 and 128, which is
+ *  checked at compile time.
+ *  Use this macro in this fashion:
+ *
+ *    RINGBUFFER(buttonEvents, 16);
+ *    ...
+ *    os_ringBufferPut(&buttonEvents, os_getInput());
+ */
+#define RINGBUFFER(NAME, CAPACITY) \
+    typedef char NAME##_capacity_must_be_power_of_two_up_to_128 \
+        [((((CAPACITY) & ((CAPACITY) - 1)) == 0) && ((CAPACITY) > 0) && ((CAPACITY) <= 128)) ? 1 : -1]; \
+    static uint8_t NAME##_data[(CAPACITY)]; \
+    RingBuffer NAME = { \
+        .head = 0, \
+        .tail = 0, \
+        .mask = (CAPACITY) - 1, \
+        .data = NAME##_data, \
+        .waiting = 0 \
+    }
+
+//----------------------------------------------------------------------------
+// Function headers
+//----------------------------------------------------------------------------
+
+//! Initializes a ring buffer with external storage
+bool os_ringBufferInit(RingBuffer* buffer, uint8_t* data, uint8_t capacity);
+
+//! Appends a byte (producer side, never blocks)
+bool os_ringBufferPut(RingBuffer* buffer, uint8_t value);
+
+//! Removes a byte if available (consumer side, never blocks)
+bool os_ringBufferGet(RingBuffer* buffer, uint8_t* value);
+
+//! Removes a byte and blocks the calling process while the buffer is empty
+uint8_t os_ringBufferGetBlocking(RingBuffer* buffer);
+
+//! Returns the number of bytes that can currently be read
+uint8_t os_ringBufferCount(RingBuffer const* buffer);
+
+//! Checks whether there is nothing to read
+bool os_ringBufferIsEmpty(RingBuffer const* buffer);
+
+//! Checks whether there is no space left to write
+bool os_ringBufferIsFull(RingBuffer const* buffer);
+
+#endif
@@ -1,10 +1,21 @@
 #include "os_scheduler.h"
+#include "os_bitmap.h"
+#include "os_stack.h"
 #include "util.h"
 #include "os_input.h"
 #include "os_scheduling_strategies.h"
+#include "os_deferred.h"
+#include "os_timer.h"
+#include "os_task.h"
+#include "os_post.h"
+#include "os_sync.h"
+#include "os_pool.h"
 #include "os_taskman.h"
 #include "os_core.h"
 #include "lcd.h"
+#if HEAP_SUPPORT
+    #include "os_memory.h"
+#endif
 
 #include <avr/interrupt.h>
 
@@ -16,12 +27,42 @@
 // Globals
 //----------------------------------------------------------------------------
 
-//! Array of states for every possible process
-Process os_processes[MAX_NUMBER_OF_PROCESSES];
+/*
+ * The process table is kept as parallel arrays (structure of arrays). The
+ * strategies mostly scan the states and priorities of all slots, which are
+ * then stored next to each other and indexed directly by the pid.
+ */
+
+//! The state of every process slot
+ProcessState os_processStates[MAX_NUMBER_OF_PROCESSES];
+
+//! The saved stack pointer of every process
+StackPointer os_processStackPointers[MAX_NUMBER_OF_PROCESSES];
+
+//! The program every process was started from
+ProgramID os_processProgramIDs[MAX_NUMBER_OF_PROCESSES];
+
+//! The priority of every process
+Priority os_processPriorities[MAX_NUMBER_OF_PROCESSES];
+
+//! The nesting depth of critical sections of every process (saved on every switch)
+uint8_t os_processCriticalSectionCounts[MAX_NUMBER_OF_PROCESSES];
+
+//! The highest address of the stack of every process
+uint16_t os_processStackBottoms[MAX_NUMBER_OF_PROCESSES];
+
+//! The stack size of every process
+StackSize os_processStackSizes[MAX_NUMBER_OF_PROCESSES];
+
+//! The stack checksum recorded when each process was switched out
+StackChecksum os_processChecksums[MAX_NUMBER_OF_PROCESSES];
 
 //! Array of function pointers for every registered program
 Program *os_programs[MAX_NUMBER_OF_PROGRAMS];
 
+//! Stack size of every program's processes (0 means STACK_SIZE_PROC)
+StackSize os_programStackSizes[MAX_NUMBER_OF_PROGRAMS];
+
 //! Index of process that is currently executed (default: idle)
 ProcessID currentProc;
 
@@ -32,11 +73,53 @@ ProcessID currentProc;
 //! Currently active scheduling strategy
 SchedulingStrategy currentSchedulingStrategy;
 
-//! Count of currently nested critical sections
+//! Count of nested critical sections of the running process (saved per process on every switch)
 uint8_t criticalSectionCount;
 
-//! Used to auto-execute programs.
-uint16_t os_autostart;
+//! Set if a timer tick hit a critical section, the switch is then made when the section is left
+bool schedulerSwitchPending;
+
+//! Set by os_yield to switch processes even if the caller is inside a critical section
+bool schedulerYieldRequested;
+
+//! Timer ticks that have not been passed to the software timers yet
+uint8_t schedulerTicksPending;
+
+//! Set while the scheduler ISR runs on its own stack, e.g. deferred work. The scheduler must not be invoked again then
+bool schedulerActive;
+
+//! The wait queue each process is blocked on (NULL if it is not waiting)
+WaitQueue* os_waitQueueOf[MAX_NUMBER_OF_PROCESSES];
+
+//! The exit code of the last process that terminated in each slot
+ExitCode os_exitCodes[MAX_NUMBER_OF_PROCESSES];
+
+//! Whether the slot holds the exit code of a terminated process (cleared by os_exec)
+bool os_exitCodeValid[MAX_NUMBER_OF_PROCESSES];
+
+//! Processes waiting in os_join for the termination of each process
+WaitQueue os_joinQueues[MAX_NUMBER_OF_PROCESSES];
+
+//! Whether each process waits in os_join for an exit code that has not been delivered yet
+bool os_joinPending[MAX_NUMBER_OF_PROCESSES];
+
+//! The exit code delivered to each joining process. Kept here, as stacks of switched out processes must not change
+ExitCode os_joinResults[MAX_NUMBER_OF_PROCESSES];
+
+//! Number of heap bytes freed when the last process terminated
+uint16_t os_reclaimedMemory;
+
+//! Used to auto-execute programs (one bit per program, set by the PROGRAM macro).
+BITMAP(os_autostart, MAX_NUMBER_OF_PROGRAMS);
+
+//! Processes whose slot is in use (any state but OS_PS_UNUSED)
+BITMAP(os_usedProcesses, MAX_NUMBER_OF_PROCESSES);
+
+//! Processes that may be selected by the scheduler (OS_PS_READY or OS_PS_RUNNING)
+BITMAP(os_readyProcesses, MAX_NUMBER_OF_PROCESSES);
+
+//! Processes suspended by os_suspend. A blocked process keeps its state and is only marked here
+BITMAP(os_suspendedProcesses, MAX_NUMBER_OF_PROCESSES);
 
 //----------------------------------------------------------------------------
 // Private function declarations
@@ -45,6 +128,18 @@ uint16_t os_autostart;
 //! ISR for timer compare match (scheduler)
 ISR(TIMER2_COMPA_vect) __attribute__((naked));
 
+//! Entered when a program function returns
+static void os_dispatcher(void);
+
+//! Changes the state of a process and keeps the process sets up to date
+static void os_setProcessState(ProcessID pid, ProcessState state);
+
+//! Checks the stack bounds and canary of a process
+static void os_checkStack(ProcessID pid);
+
+//! Calculates the checksum the scheduler records for a switched out process
+static StackChecksum os_getSwitchChecksum(ProcessID pid);
+
 //----------------------------------------------------------------------------
 // Function definitions
 //----------------------------------------------------------------------------
@@ -61,39 +156,80 @@ ISR(TIMER2_COMPA_vect) {
     //sichere Laufzeikontext
 	saveContext();
 	
-	//sichere Stackpointer des Prozesses
-	os_processes[os_getCurrentProc()].sp.as_int = SP;
+	//Scheduler gesperrt: Prozesswechsel aufschieben, bis der kritische Bereich verlassen wird
+	if (criticalSectionCount && !schedulerYieldRequested) {
+		schedulerSwitchPending = true;
+		if (schedulerTicksPending < UINT8_MAX) {
+			schedulerTicksPending++;
+		}
+		restoreContext();
+	}
+	//nur echte Timer Interrupts zhlen als Tick, nicht os_yield (sttigend, damit keine Ticks verloren gehen)
+	if (!schedulerYieldRequested && schedulerTicksPending < UINT8_MAX) {
+		schedulerTicksPending++;
+	}
+	schedulerSwitchPending = false;
+	schedulerYieldRequested = false;
+	
+	//sichere Stackpointer und Verschachtelungstiefe des Prozesses
+	os_processStackPointers[os_getCurrentProc()].as_int = SP;
+	os_processCriticalSectionCounts[os_getCurrentProc()] = criticalSectionCount;
 	
 	//lade Scheduler Stack in das SP Register
 	SP = BOTTOM_OF_ISR_STACK;
+	schedulerActive = true;
+	
+	//Stackberlauf des unterbrochenen Prozesses in O(1) erkennen
+	os_checkStack(os_getCurrentProc());
+	
+	//Prfsumme des unterbrochenen Prozesses zusammen mit dem gesicherten Stackpointer merken
+	os_processChecksums[os_getCurrentProc()] = os_getSwitchChecksum(os_getCurrentProc());
+	
+	//Software Timer und schlafende Tasks weiterzhlen, fllige Arbeit landet in der Warteschlange fr aufgeschobene Arbeiten
+	os_timerTick(schedulerTicksPending);
+	os_taskTick(schedulerTicksPending);
+	schedulerTicksPending = 0;
 	
-	//aktueller Prozess geht von running auf ready
-	os_processes[os_getCurrentProc()].state = OS_PS_READY;
+	//aufgeschobene Arbeiten der ISRs auf dem Scheduler Stack erledigen
+	os_runDeferredWork();
+	
+	//aktueller Prozess geht von running auf ready, blockierte Prozesse bleiben blockiert
+	//(die Prozessmengen ndern sich dabei nicht, daher ohne os_setProcessState)
+	if (os_processStates[os_getCurrentProc()] == OS_PS_RUNNING) {
+		os_processStates[os_getCurrentProc()] = OS_PS_READY;
+	}
 	
 	//Asuwahl des nchsten prozesses je nach Schedule Strategy
 	switch(currentSchedulingStrategy){
 		case OS_SS_EVEN:
-			currentProc = os_Scheduler_Even(os_processes, os_getCurrentProc());
+			currentProc = os_Scheduler_Even(os_getCurrentProc());
 			break;
 		case OS_SS_RANDOM:
-			currentProc = os_Scheduler_Random(os_processes, os_getCurrentProc());
+			currentProc = os_Scheduler_Random(os_getCurrentProc());
 			break;
 		case OS_SS_ROUND_ROBIN:
-			currentProc = os_Scheduler_RoundRobin(os_processes, os_getCurrentProc());
+			currentProc = os_Scheduler_RoundRobin(os_getCurrentProc());
 			break;
 		case OS_SS_RUN_TO_COMPLETION:
-			currentProc = os_Scheduler_RunToCompletion(os_processes, os_getCurrentProc());
+			currentProc = os_Scheduler_RunToCompletion(os_getCurrentProc());
 			break;
 		default:
-			currentProc = os_Scheduler_InactiveAging(os_processes, os_getCurrentProc());
+			currentProc = os_Scheduler_InactiveAging(os_getCurrentProc());
 			break;
 	}
 	
 	//fortzufhrender Prozess geht auf running
-	os_processes[os_getCurrentProc()].state = OS_PS_RUNNING;
+	os_processStates[os_getCurrentProc()] = OS_PS_RUNNING;
 	
-	//stackpointer fr fortzufhrenden Prozess wiederherstellen
-	SP = os_processes[os_getCurrentProc()].sp.as_int;
+	//Stack des fortzufhrenden Prozesses darf sich seit dem Auslagern nicht verndert haben
+	if (os_getSwitchChecksum(os_getCurrentProc()) != os_processChecksums[os_getCurrentProc()]) {
+		os_error("Stack veraendert");
+	}
+	
+	//Verschachtelungstiefe und stackpointer fr fortzufhrenden Prozess wiederherstellen
+	criticalSectionCount = os_processCriticalSectionCounts[os_getCurrentProc()];
+	schedulerActive = false;
+	SP = os_processStackPointers[os_getCurrentProc()].as_int;
 	
 	//Laufzeitkontext des fortzufhrenden Prozesses wird wiederhergestellt
 	restoreContext();
@@ -133,16 +269,59 @@ ProgramID os_registerProgram(Program* program) {
  *  \return True if the program with the specified ID is to be auto started.
  */
 bool os_checkAutostartProgram(ProgramID programID) {
-    return !!(os_autostart & (1 << programID));
+    return programID < MAX_NUMBER_OF_PROGRAMS && BITMAP_TEST(os_autostart, programID);
+}
+
+/*!
+ *  Sets the stack size that processes of a program get. This is called by the
+ *  PROGRAM macro if a stack size is passed to it, but may also be used for
+ *  programs registered with os_registerProgram. The size applies to processes
+ *  started afterwards.
+ *
+ *  \param programID The program whose stack size is set.
+ *  \param size The stack size in bytes (at least STACK_SIZE_PROC_MIN) or 0
+ *              for the default size STACK_SIZE_PROC.
+ *  \return True on success, false if the program id or size is invalid.
+ */
+bool os_setProgramStackSize(ProgramID programID, StackSize size) {
+    if (programID >= MAX_NUMBER_OF_PROGRAMS || (size && (size < STACK_SIZE_PROC_MIN || size > STACK_SIZE_PROCS))) {
+        return false;
+    }
+
+    os_programStackSizes[programID] = size;
+    return true;
+}
+
+/*!
+ *  Returns the stack size that processes of a program get.
+ *
+ *  \param programID The program to look up.
+ *  \return The stack size in bytes.
+ */
+StackSize os_getProgramStackSize(ProgramID programID) {
+    if (programID >= MAX_NUMBER_OF_PROGRAMS || !os_programStackSizes[programID]) {
+        return STACK_SIZE_PROC;
+    }
+
+    return os_programStackSizes[programID];
 }
 
 /*!
  *  This is the idle program. The idle process owns all the memory
- *  and processor time no other process wants to have.
+ *  and processor time no other process wants to have. It uses that time
+ *  to compact the heaps step by step.
  */
 PROGRAM(0, AUTOSTART) {
     while(1){
 		lcd_writeString(".");
+#if HEAP_SUPPORT
+		//verschiebbare Chunks in Richtung Heapanfang schieben
+		for (uint8_t i = 0; i < os_getHeapListLength(); i++) {
+			if (os_lookupHeap(i)) {
+				os_compactStep(os_lookupHeap(i));
+			}
+		}
+#endif
 		delayMs(DEFAULT_OUTPUT_DELAY);
 	}
 }
@@ -185,9 +364,11 @@ ProgramID os_lookupProgramID(Program* program) {
 /*!
  *  This function is used to execute a program that has been introduced with
  *  os_registerProgram.
- *  A stack will be provided if the process limit has not yet been reached.
+ *  A stack of the program's stack size will be provided if the process limit
+ *  has not yet been reached and the stack region has a large enough gap.
  *  This function is multitasking safe. That means that programs can repost
  *  themselves, simulating TinyOS 2 scheduling (just kick off interrupts ;) ).
+ *  For short event handlers os_post is much cheaper, as it needs no stack.
  *
  *  \param programID The program id of the program to start (index of os_programs).
  *  \param priority A priority ranging 0..255 for the new process:
@@ -199,52 +380,96 @@ ProgramID os_lookupProgramID(Program* program) {
  *          defines.h on failure
  */
 ProcessID os_exec(ProgramID programID, Priority priority) {
+	return os_execWithArg(programID, priority, NULL);
+}
+
+/*!
+ *  Works like os_exec, but additionally passes an argument to the program
+ *  function. The argument is placed in r24:r25 of the initial context, which
+ *  is where avr-gcc expects the first parameter of a function. This way one
+ *  program can be started several times to work on different data.
+ *
+ *  \param programID The program id of the program to start (index of os_programs).
+ *  \param priority A priority ranging 0..255 for the new process.
+ *  \param arg The argument that is passed to the program function.
+ *  \return The index of the new process or INVALID_PROCESS on failure
+ */
+ProcessID os_execWithArg(ProgramID programID, Priority priority, void* arg) {
     //kritischer Bereich
 	os_enterCriticalSection();
-	for (ProcessID pid = 0 ; pid < MAX_NUMBER_OF_PROCESSES ; pid++){
-		/*prozess state ist unused wenn
+	/*erster Prozessslot, der nicht in der Menge der belegten Slots ist.
+		Ein Slot ist frei wenn
 			a) gerade initialisiert
 			b) state auf unused gesetzt
-		*/
-		if (os_processes[pid].state == OS_PS_UNUSED){
-			//whle program aus mit hilfsfunktion
-			Program *funktionszeiger = os_lookupProgramFunction(programID);
-			//Nullpointer test
-			if(funktionszeiger == NULL){
-				//kritischen Bereich verlassen und Funktion beenden
-				os_leaveCriticalSection();
-				return INVALID_PROCESS;
-			}else{
-				//Prozesszustand, Prioritt und ProgramID speichern
-				os_processes[pid].state = OS_PS_READY;
-				os_processes[pid].priority = priority;
-				os_processes[pid].progID = programID;
-				//Prozessstack vorbereiten
-				StackPointer sp;
-				//geh zum Boden des Stacks
-				sp.as_int = PROCESS_STACK_BOTTOM(pid);
-				
-				//16 bit funktionszeiger als initiale Rcksrpungadresse speichern
-				uint8_t lowbyte = (uint8_t) (funktionszeiger & 0x00ff);
-				*(sp.as_ptr) = lowbyte;
-				sp.as_int -= 1;
-				uint8_t highbyte = (uint8_t) (funktionszeiger >> 8);
-				*(sp.as_ptr) = highbyte;
-				sp.as_int -= 1;
-				
-				//33 0 Bytes folgen. 1 fr Statusregister (SREG) und 32 fr Laufzeitkontext
-				for (uint8_t i = 0 ; i < 33 ; i++){
+	*/
+	ProcessID pid = os_bitmapFirstClear(os_usedProcesses, MAX_NUMBER_OF_PROCESSES);
+	if (pid < MAX_NUMBER_OF_PROCESSES){
+		//whle program aus mit hilfsfunktion
+		Program *funktionszeiger = os_lookupProgramFunction(programID);
+		//Nullpointer test
+		//Stack mit der Gre des Programms aus dem Stackbereich holen
+		StackSize stackSize = os_getProgramStackSize(programID);
+		uint16_t stackBottom = 0;
+		if(funktionszeiger != NULL){
+			stackBottom = os_stackAlloc(stackSize);
+		}
+		//Nullpointer oder kein Platz fr den Stack
+		if(funktionszeiger == NULL || stackBottom == 0){
+			//kritischen Bereich verlassen und Funktion beenden
+			os_leaveCriticalSection();
+			return INVALID_PROCESS;
+		}else{
+			//Prozesszustand, Prioritt und ProgramID speichern
+			os_setProcessState(pid, OS_PS_READY);
+			os_processPriorities[pid] = priority;
+			os_processProgramIDs[pid] = programID;
+			os_processCriticalSectionCounts[pid] = 0;
+			os_processStackBottoms[pid] = stackBottom;
+			os_processStackSizes[pid] = stackSize;
+			os_exitCodeValid[pid] = false;
+			//Prozessstack vorbereiten: mit Muster bemalen und Canary am unteren Ende setzen
+			os_stackPaint(stackBottom, stackSize);
+			StackPointer sp;
+			//geh zum Boden des Stacks
+			sp.as_int = stackBottom;
+			
+			//Dispatcher als Rcksprungadresse des Programms speichern, damit ein zurckkehrendes Programm beendet wird
+			uint16_t dispatcheradresse = (uint16_t) os_dispatcher;
+			*(sp.as_ptr) = (uint8_t) (dispatcheradresse & 0x00ff);
+			sp.as_int -= 1;
+			*(sp.as_ptr) = (uint8_t) (dispatcheradresse >> 8);
+			sp.as_int -= 1;
+			
+			//16 bit funktionszeiger als initiale Rcksrpungadresse speichern
+			uint16_t adresse = (uint16_t) funktionszeiger;
+			uint8_t lowbyte = (uint8_t) (adresse & 0x00ff);
+			*(sp.as_ptr) = lowbyte;
+			sp.as_int -= 1;
+			uint8_t highbyte = (uint8_t) (adresse >> 8);
+			*(sp.as_ptr) = highbyte;
+			sp.as_int -= 1;
+			
+			//33 Bytes folgen. 1 fr Statusregister (SREG) und 32 fr Laufzeitkontext
+			//Reihenfolge wie in saveContext: r31, SREG, r30, ..., r0. Das Argument liegt in r24:r25, alles andere ist 0
+			uint16_t argument = (uint16_t) arg;
+			for (uint8_t i = 0 ; i < 33 ; i++){
+				if (i == 7) {
+					*(sp.as_ptr) = (uint8_t) (argument >> 8);
+				} else if (i == 8) {
+					*(sp.as_ptr) = (uint8_t) (argument & 0x00ff);
+				} else {
 					*(sp.as_ptr) = 0x00;
-					sp.as_int -= 1;
 				}
-				
-				//speichere Stackpointer im zu initialisierenden Prozess
-				os_processes[pid].sp.as_int = sp.as_int;
-				
-				//kritischen Bereich verlassen und Funktion beenden
-				os_leaveCriticalSection();
-				return pid;
+				sp.as_int -= 1;
 			}
+			
+			//speichere Stackpointer im zu initialisierenden Prozess
+			os_processStackPointers[pid].as_int = sp.as_int;
+			os_processChecksums[pid] = os_getSwitchChecksum(pid);
+			
+			//kritischen Bereich verlassen und Funktion beenden
+			os_leaveCriticalSection();
+			return pid;
 		}
 	}
 	//keine unbenutzen Prozessslots
@@ -253,6 +478,262 @@ ProcessID os_exec(ProgramID programID, Priority priority) {
 	return INVALID_PROCESS;
 }
 
+/*!
+ *  Terminates a process. Its slot is released, along with its scheduling
+ *  information, all mutexes and write locks it holds and all its heap memory. A process waiting on a wait queue is
+ *  removed from it. The exit code is handed to all processes waiting in
+ *  os_join. If the current process terminates itself, the scheduler is
+ *  invoked right away and this function does not return. Called from deferred
+ *  work, the interrupted process is only marked as terminated and the running
+ *  scheduler picks another one afterwards.
+ *  Note that reader-writer locks held by the process for reading are not released.
+ *
+ *  \param pid The process to terminate. The idle process cannot be terminated.
+ *  \param code The exit code of the process.
+ *  \return True if the process was terminated.
+ */
+static bool os_terminate(ProcessID pid, ExitCode code) {
+	//kritischer Bereich
+	os_enterCriticalSection();
+	
+	//Idle und ungltige oder unbenutzte Slots knnen nicht beendet werden
+	if (pid == 0 || pid >= MAX_NUMBER_OF_PROCESSES || os_processStates[pid] == OS_PS_UNUSED) {
+		os_leaveCriticalSection();
+		return false;
+	}
+	
+	//aus der Warteschlange austragen, auf die der Prozess wartet (auch ISRs greifen darauf zu)
+	uint8_t sreg = SREG;
+	cli();
+	if (os_waitQueueOf[pid]) {
+		*os_waitQueueOf[pid] &= ~WAITQUEUE_BIT(pid);
+		os_waitQueueOf[pid] = NULL;
+	}
+	os_joinPending[pid] = false;
+	BITMAP_CLEAR(os_suspendedProcesses, pid);
+	
+	//Exitcode speichern und an alle wartenden os_join Aufrufer ausliefern
+	os_exitCodes[pid] = code;
+	os_exitCodeValid[pid] = true;
+	for (ProcessID joiner = 0; joiner < MAX_NUMBER_OF_PROCESSES; joiner++) {
+		if ((os_joinQueues[pid] & WAITQUEUE_BIT(joiner)) && os_joinPending[joiner]) {
+			os_joinResults[joiner] = code;
+			os_joinPending[joiner] = false;
+		}
+	}
+	os_waitQueueWakeAll(&os_joinQueues[pid]);
+	SREG = sreg;
+	
+	//gehaltene Mutexe und Schreibsperren freigeben und Slot freigeben
+	os_releaseMutexes(pid);
+	os_releaseRWLocks(pid);
+	os_poolFreeProcessBlocks(pid);
+#if HEAP_SUPPORT
+	//Speicher des Prozesses auf allen Heaps freigeben und zhlen, wie viel es war
+	os_reclaimedMemory = 0;
+	for (uint8_t i = 0; i < os_getHeapListLength(); i++) {
+		if (os_lookupHeap(i)) {
+			os_reclaimedMemory += os_freeProcessMemory(os_lookupHeap(i), pid);
+		}
+	}
+#endif
+	os_setProcessState(pid, OS_PS_UNUSED);
+	os_resetProcessSchedulingInformation(pid);
+	
+	//Stack freigeben. Ein Prozess, der sich selbst beendet, luft bis os_yield noch darauf,
+	//das ist sicher, weil erst nach dem Prozesswechsel ein neuer Prozess den Speicher bekommt
+	os_stackFree(os_processStackBottoms[pid]);
+	
+	//hat sich der Prozess selbst beendet, sofort einen anderen Prozess auswhlen
+	//(in aufgeschobener Arbeit whlt der laufende Scheduler danach ohnehin einen anderen aus)
+	if (pid == os_getCurrentProc() && !schedulerActive) {
+		os_yield();
+	}
+	
+	//kritischen Bereich verlassen und Funktion beenden
+	os_leaveCriticalSection();
+	return true;
+}
+
+/*!
+ *  Kills a process. Its exit code is set to EXIT_CODE_KILLED. If the current
+ *  process kills itself, this function does not return.
+ *
+ *  \param pid The process to kill. The idle process cannot be killed.
+ *  \return True if the process was killed.
+ */
+bool os_kill(ProcessID pid) {
+	return os_terminate(pid, EXIT_CODE_KILLED);
+}
+
+/*!
+ *  Terminates the current process with the passed exit code. Processes
+ *  waiting in os_join for it are woken up. This function does not return,
+ *  unless it is called from deferred work, which terminates the interrupted
+ *  process.
+ *
+ *  \param code The exit code to report.
+ */
+void os_exit(ExitCode code) {
+	//kehrt nur in aufgeschobener Arbeit zurck
+	if (os_terminate(os_getCurrentProc(), code)) {
+		return;
+	}
+	
+	//wird nur vom Idle Prozess erreicht, der sich nicht beenden kann
+	os_error("Idle kann nicht beendet werden");
+	while (1) {
+	}
+}
+
+/*!
+ *  Returns how many bytes of heap memory were freed when the last process
+ *  terminated. The task manager shows this after killing a process.
+ *
+ *  \return The number of bytes freed on all heaps, including management data.
+ */
+uint16_t os_getReclaimedMemory(void) {
+	return os_reclaimedMemory;
+}
+
+/*!
+ *  Blocks the current process until the passed process has terminated and
+ *  returns its exit code. If the process has already terminated and its slot
+ *  has not been reused yet, the exit code is returned right away.
+ *
+ *  \param pid The process to wait for.
+ *  \param code Where to store the exit code. May be NULL.
+ *  \return True on success, false if there is no such process (or exit code)
+ *          or if a process tries to join itself.
+ *          The idle process and deferred work cannot block, so they get an
+ *          error and false.
+ */
+bool os_join(ProcessID pid, ExitCode* code) {
+	if (pid >= MAX_NUMBER_OF_PROCESSES || pid == os_getCurrentProc()) {
+		return false;
+	}
+	
+	//wer nicht blockieren darf, wrde sonst endlos auf den Exitcode warten
+	if (os_getCurrentProc() == 0 || schedulerActive) {
+		os_error("os_join darf nicht blockieren");
+		return false;
+	}
+	
+	//speicher SREG und deaktiviere Interrupts
+	uint8_t sreg = SREG;
+	cli();
+	
+	bool joined = os_exitCodeValid[pid];
+	ExitCode result = os_exitCodes[pid];
+	
+	if (os_processStates[pid] != OS_PS_UNUSED) {
+		//warten, bis os_terminate den Exitcode ausgeliefert hat
+		os_joinPending[os_getCurrentProc()] = true;
+		while (os_joinPending[os_getCurrentProc()]) {
+			os_waitQueueBlock(&os_joinQueues[pid]);
+		}
+		result = os_joinResults[os_getCurrentProc()];
+		joined = true;
+	}
+	
+	//Wiederherstellung des gespeicherten SREG
+	SREG = sreg;
+	
+	if (joined && code) {
+		*code = result;
+	}
+	return joined;
+}
+
+/*!
+ *  Suspends a process until it is resumed with os_resume. A ready or running
+ *  process goes to OS_PS_SUSPENDED and is not scheduled anymore. A blocked
+ *  process stays in its wait queue and goes to OS_PS_SUSPENDED instead of
+ *  OS_PS_READY when it is woken up, so no wakeup is lost.
+ *  If the current process suspends itself, this function returns once it has
+ *  been resumed. Called from deferred work, the interrupted process is only
+ *  marked and this function returns right away.
+ *
+ *  \param pid The process to suspend. The idle process cannot be suspended.
+ *  \return True if the process was suspended, false if it does not exist or
+ *          is already suspended.
+ */
+bool os_suspend(ProcessID pid) {
+	if (pid == 0 || pid >= MAX_NUMBER_OF_PROCESSES) {
+		return false;
+	}
+	
+	//speicher SREG und deaktiviere Interrupts
+	uint8_t sreg = SREG;
+	cli();
+	
+	bool const success = os_processStates[pid] != OS_PS_UNUSED && !BITMAP_TEST(os_suspendedProcesses, pid);
+	if (success) {
+		BITMAP_SET(os_suspendedProcesses, pid);
+		if (BITMAP_TEST(os_readyProcesses, pid)) {
+			os_setProcessState(pid, OS_PS_SUSPENDED);
+		}
+		//hat sich der Prozess selbst angehalten, Prozessor bis zum os_resume abgeben
+		//(in aufgeschobener Arbeit whlt der laufende Scheduler danach ohnehin einen anderen aus)
+		if (pid == os_getCurrentProc() && !schedulerActive) {
+			os_yield();
+		}
+	}
+	
+	//Wiederherstellung des gespeicherten SREG
+	SREG = sreg;
+	return success;
+}
+
+/*!
+ *  Resumes a process suspended by os_suspend. If it is not waiting in a wait
+ *  queue, it becomes ready again.
+ *
+ *  \param pid The process to resume.
+ *  \return True if the process was resumed, false if it was not suspended.
+ */
+bool os_resume(ProcessID pid) {
+	if (pid >= MAX_NUMBER_OF_PROCESSES) {
+		return false;
+	}
+	
+	//speicher SREG und deaktiviere Interrupts
+	uint8_t sreg = SREG;
+	cli();
+	
+	bool const success = BITMAP_TEST(os_suspendedProcesses, pid);
+	if (success) {
+		BITMAP_CLEAR(os_suspendedProcesses, pid);
+		if (os_processStates[pid] == OS_PS_SUSPENDED) {
+			os_setProcessState(pid, OS_PS_READY);
+		}
+	}
+	
+	//Wiederherstellung des gespeicherten SREG
+	SREG = sreg;
+	return success;
+}
+
+/*!
+ *  Checks whether a process has been suspended by os_suspend. This is also
+ *  true for a suspended process that is still blocked.
+ *
+ *  \param pid The process to check.
+ *  \return True if the process is suspended.
+ */
+bool os_isSuspended(ProcessID pid) {
+	return pid < MAX_NUMBER_OF_PROCESSES && BITMAP_TEST(os_suspendedProcesses, pid);
+}
+
+/*!
+ *  The dispatcher is placed below the program function on every new process
+ *  stack. If a program function returns, execution continues here and the
+ *  process is terminated cleanly with exit code 0.
+ */
+static void os_dispatcher(void) {
+	os_exit(0);
+}
+
 /*!
  *  If all processes have been registered for execution, the OS calls this
  *  function to start the idle program and the concurrent execution of the
@@ -260,8 +741,9 @@ ProcessID os_exec(ProgramID programID, Priority priority) {
  */
 void os_startScheduler(void) {
 	currentProc = 0;
-	os_processes[os_getCurrentProc()].state = OS_PS_RUNNING;
-	PS = os_processes[os_getCurrentProc()].sp.as_int;
+	os_setProcessState(os_getCurrentProc(), OS_PS_RUNNING);
+	criticalSectionCount = os_processCriticalSectionCounts[os_getCurrentProc()];
+	SP = os_processStackPointers[os_getCurrentProc()].as_int;
 	restoreContext();
 }
 
@@ -272,7 +754,7 @@ void os_startScheduler(void) {
 void os_initScheduler(void) {
 	//alle Prozessezustnde werden auf unused gesetzt
     for(ProcessID pid = 0 ; pid < MAX_NUMBER_OF_PROCESSES ; pid++){
-		os_processes[pid].state = OS_PS_UNUSED;
+		os_setProcessState(pid, OS_PS_UNUSED);
 	}
 	//jedes Program, was automatisch starten soll, wird ein Prozess zugeteilt
 	for(ProgramID progID = 0 ; progID < MAX_NUMBER_OF_PROGRAMS ; progID++){
@@ -280,16 +762,112 @@ void os_initScheduler(void) {
 			os_exec(progID, DEFAULT_PRIORITY);
 		}
 	}
+#if POST_SUPPORT
+	//Worker fr os_post starten, nach dem Idle Prozess, damit dieser pid 0 behlt
+	os_initPost();
+#endif
 }
 
 /*!
- *  A simple getter for the slot of a specific process.
+ *  Changes the state of a process. Every state change outside of the
+ *  scheduler's RUNNING/READY swap goes through here, so the sets of used and
+ *  ready processes always match the process table. Must be called with
+ *  interrupts disabled or inside a critical section.
+ *
+ *  \param pid The process whose state is changed.
+ *  \param state The new state of the process.
+ */
+static void os_setProcessState(ProcessID pid, ProcessState state) {
+	os_processStates[pid] = state;
+	
+	if (state == OS_PS_UNUSED) {
+		BITMAP_CLEAR(os_usedProcesses, pid);
+	} else {
+		BITMAP_SET(os_usedProcesses, pid);
+	}
+	
+	if (state == OS_PS_READY || state == OS_PS_RUNNING) {
+		BITMAP_SET(os_readyProcesses, pid);
+	} else {
+		BITMAP_CLEAR(os_readyProcesses, pid);
+	}
+}
+
+/*!
+ *  Returns a copy of all properties of a process. As the process table is
+ *  stored as parallel arrays, there is no struct to point to. The copy is
+ *  taken with interrupts disabled, so its fields belong together. Code that
+ *  needs a single property should use its getter (e.g. os_getProcessState),
+ *  the setters (e.g. os_setProcessPriority) change the properties.
  *
  *  \param pid The processID of the process to be handled
- *  \return A pointer to the memory of the process at position pid in the os_processes array.
+ *  \return A snapshot of the process at position pid of the process table.
  */
-Process* os_getProcessSlot(ProcessID pid) {
-    return os_processes + pid;
+Process os_getProcessSnapshot(ProcessID pid) {
+    uint8_t const sreg = SREG;
+    cli();
+    Process const process = {
+        .state = os_processStates[pid],
+        .sp = os_processStackPointers[pid],
+        .progID = os_processProgramIDs[pid],
+        .priority = os_processPriorities[pid],
+        .criticalSectionCount = os_processCriticalSectionCounts[pid],
+        .stackBottom = os_processStackBottoms[pid],
+        .stackSize = os_processStackSizes[pid],
+        .checksum = os_processChecksums[pid]
+    };
+    SREG = sreg;
+    return process;
+}
+
+/*!
+ *  A simple getter for the state of a process.
+ *
+ *  \param pid The processID of the process to be handled
+ *  \return The state of the process.
+ */
+ProcessState os_getProcessState(ProcessID pid) {
+    return os_processStates[pid];
+}
+
+/*!
+ *  A simple getter for the priority of a process.
+ *
+ *  \param pid The processID of the process to be handled
+ *  \return The priority of the process.
+ */
+Priority os_getProcessPriority(ProcessID pid) {
+    return os_processPriorities[pid];
+}
+
+/*!
+ *  Changes the priority of a process.
+ *
+ *  \param pid The processID of the process to be handled
+ *  \param priority The new priority of the process.
+ */
+void os_setProcessPriority(ProcessID pid, Priority priority) {
+    os_processPriorities[pid] = priority;
+}
+
+/*!
+ *  A simple getter for the program a process was started from.
+ *
+ *  \param pid The processID of the process to be handled
+ *  \return The id of the program of the process.
+ */
+ProgramID os_getProcessProgramID(ProcessID pid) {
+    return os_processProgramIDs[pid];
+}
+
+/*!
+ *  A simple getter for the stack size of a process.
+ *
+ *  \param pid The processID of the process to be handled
+ *  \return The size of the stack of the process in bytes.
+ */
+StackSize os_getProcessStackSize(ProcessID pid) {
+    return os_processStackSizes[pid];
 }
 
 /*!
@@ -317,14 +895,7 @@ ProcessID os_getCurrentProc(void) {
  *  \returns The number currently active (not unused) process-slots.
  */
 uint8_t os_getNumberOfActiveProcs(void) {
-    uint8_t num = 0;
-
-    ProcessID i = 0;
-    do {
-        num += os_getProcessSlot(i)->state != OS_PS_UNUSED;
-    } while (++i < MAX_NUMBER_OF_PROCESSES);
-
-    return num;
+    return os_bitmapCount(os_usedProcesses, sizeof(os_usedProcesses));
 }
 
 /*!
@@ -359,10 +930,13 @@ SchedulingStrategy os_getSchedulingStrategy(void) {
 }
 
 /*!
- *  Enters a critical code section by disabling the scheduler if needed.
- *  This function stores the nesting depth of critical sections of the current
- *  process (e.g. if a function with a critical section is called from another
- *  critical section) to ensure correct behavior when leaving the section.
+ *  Enters a critical code section by locking the scheduler.
+ *  The timer interrupt keeps running, but a tick that occurs inside a critical
+ *  section does not switch processes. The switch is deferred until the
+ *  outermost critical section is left, so no tick is lost.
+ *  The nesting depth belongs to the current process and is saved and restored
+ *  on every context switch. Hence a process may block or yield inside a
+ *  critical section without locking the scheduler for all other processes.
  *  This function supports up to 255 nested critical sections.
  */
 void os_enterCriticalSection(void) {
@@ -372,21 +946,24 @@ void os_enterCriticalSection(void) {
 	//deaktiviere GIEB
 	SREG &= 0b01111111; 
 	
-	//inkrementiere Verschatelungstiefe um 1
-	criticalSectionCount++;
-	
-	//deaktiviere Scheduler mit OCIE2A Bit (1. Bit)
-	TIMSK2 &= 0b11111101;
+	if (criticalSectionCount == UINT8_MAX) {
+		//Fehlermeldung, falls die Verschachtelungstiefe berlaufen wrde
+		os_error("Zu viele verschachtelte kritische Bereiche");
+	} else {
+		//inkrementiere Verschatelungstiefe um 1, sperrt den Scheduler
+		criticalSectionCount++;
+	}
 	
 	//Wiederherstellung des gespeicherten GIEB
 	SREG |= GlobalInterruptEnableBit;
 }
 
 /*!
- *  Leaves a critical code section by enabling the scheduler if needed.
+ *  Leaves a critical code section.
  *  This function utilizes the nesting depth of critical sections
  *  stored by os_enterCriticalSection to check if the scheduler
- *  has to be reactivated.
+ *  is unlocked again. If a timer tick was deferred in the meantime,
+ *  the process switch is made up for right away.
  */
 void os_leaveCriticalSection(void) {
     //speicher GIEB
@@ -395,19 +972,211 @@ void os_leaveCriticalSection(void) {
     //deaktiviere GIEB
     SREG &= 0b01111111;
 	
-	//dekrementiere Verschaftelungstiefe um 1
-	criticalSectionCount--;
-	
-	if(criticalSectionCount < 0){
+	if (criticalSectionCount == 0) {
 		//Fehlermeldung, falls mehr Kritische Bereiche verlassen wurden als betreten wurden
 		os_error("Zu oft os_leaveCriticalSection aufgerufen");
-	} else if(criticalSectionCount == 0){
-		//aktiviere Scheduler mit OCIE2A Bit (1. Bit) falls kein kritischer Bereich vorliegt
-		TIMSK2 |= 0b00000010; 
+	} else {
+		//dekrementiere Verschaftelungstiefe um 1
+		criticalSectionCount--;
 	}
 	
 	//Wiederherstellung des gespeicherten GIEB
 	SREG |= GlobalInterruptEnableBit;
+	
+	//aufgeschobenen Prozesswechsel nachholen, falls Interrupts erlaubt sind
+	if (criticalSectionCount == 0 && schedulerSwitchPending && GlobalInterruptEnableBit) {
+		os_yield();
+	}
+}
+
+/*!
+ *  Voluntarily hands the processor to the scheduler. The scheduler ISR is
+ *  invoked directly, so the current process is suspended like on a regular
+ *  timer tick and the next process is chosen by the active strategy.
+ *  This also works from within a critical section, as the nesting depth is
+ *  saved with the rest of the process' state and restored once the caller is
+ *  scheduled again.
+ *  Deferred work runs inside the scheduler, which picks the next process
+ *  afterwards anyway, so there this function returns right away.
+ */
+void os_yield(void) {
+	//der Scheduler luft bereits, ein erneuter Aufruf wrde seinen Stack berschreiben
+	if (schedulerActive) {
+		return;
+	}
+	
+	//speicher SREG und deaktiviere Interrupts
+	uint8_t sreg = SREG;
+	cli();
+	
+	//Prozesswechsel erzwingen, auch wenn der Scheduler gesperrt ist
+	schedulerYieldRequested = true;
+	
+	//Scheduler aufrufen, kehrt erst zurck, wenn dieser Prozess wieder luft
+	TIMER2_COMPA_vect();
+	
+	//Wiederherstellung des gespeicherten SREG
+	SREG = sreg;
+}
+
+/*!
+ *  Blocks the current process on the passed wait queue until it is woken up
+ *  by os_waitQueueWakeOne or os_waitQueueWakeAll. The process is marked as
+ *  OS_PS_BLOCKED, so no strategy will pick it until then.
+ *  The caller must have disabled interrupts (or entered a critical section)
+ *  while checking its wait condition, otherwise a wakeup may be lost. The
+ *  interrupt state is the same when this function returns. Callers should
+ *  re-check their condition after returning.
+ *  The idle process and deferred work must never block.
+ *
+ *  \param queue The wait queue to enqueue the current process in.
+ */
+void os_waitQueueBlock(WaitQueue* queue) {
+	//speicher SREG und deaktiviere Interrupts
+	uint8_t sreg = SREG;
+	cli();
+	
+	if (os_getCurrentProc() == 0) {
+		os_error("Idle darf nicht blockieren");
+		SREG = sreg;
+		return;
+	}
+	if (schedulerActive) {
+		os_error("Aufgeschobene Arbeit darf nicht blockieren");
+		SREG = sreg;
+		return;
+	}
+	
+	//Prozess in die Warteschlange eintragen und blockieren
+	*queue |= WAITQUEUE_BIT(os_getCurrentProc());
+	os_waitQueueOf[os_getCurrentProc()] = queue;
+	os_setProcessState(os_getCurrentProc(), OS_PS_BLOCKED);
+	
+	//Prozessor abgeben bis der Prozess aufgeweckt wurde
+	os_yield();
+	
+	//Wiederherstellung des gespeicherten SREG
+	SREG = sreg;
+}
+
+/*!
+ *  Helper for the wakeup functions that puts a single blocked process back
+ *  into the ready state.
+ *
+ *  \param pid The process to wake up.
+ */
+static void os_wakeProcess(ProcessID pid) {
+	os_waitQueueOf[pid] = NULL;
+	if (os_processStates[pid] == OS_PS_BLOCKED) {
+		//ein angehaltener Prozess bleibt angehalten, bis os_resume aufgerufen wird
+		os_setProcessState(pid, BITMAP_TEST(os_suspendedProcesses, pid) ? OS_PS_SUSPENDED : OS_PS_READY);
+	}
+}
+
+/*!
+ *  Wakes up the waiting process with the highest priority (the lowest
+ *  process id on equal priorities) and removes it from the wait queue.
+ *  This function may be called from processes and ISRs.
+ *
+ *  \param queue The wait queue to wake a process from.
+ *  \return True if a process was woken up.
+ */
+bool os_waitQueueWakeOne(WaitQueue* queue) {
+	//speicher SREG und deaktiviere Interrupts
+	uint8_t sreg = SREG;
+	cli();
+	
+	//wartenden Prozess mit hchster Prioritt suchen
+	ProcessID chosen = INVALID_PROCESS;
+	for (ProcessID pid = 0; pid < MAX_NUMBER_OF_PROCESSES; pid++) {
+		if ((*queue & WAITQUEUE_BIT(pid)) && (chosen == INVALID_PROCESS || os_processPriorities[pid] > os_processPriorities[chosen])) {
+			chosen = pid;
+		}
+	}
+	
+	if (chosen != INVALID_PROCESS) {
+		*queue &= ~WAITQUEUE_BIT(chosen);
+		os_wakeProcess(chosen);
+	}
+	
+	//Wiederherstellung des gespeicherten SREG
+	SREG = sreg;
+	return chosen != INVALID_PROCESS;
+}
+
+/*!
+ *  Wakes up all processes waiting in the passed wait queue and empties it.
+ *  This function may be called from processes and ISRs.
+ *
+ *  \param queue The wait queue to wake all processes from.
+ */
+void os_waitQueueWakeAll(WaitQueue* queue) {
+	//speicher SREG und deaktiviere Interrupts
+	uint8_t sreg = SREG;
+	cli();
+	
+	for (ProcessID pid = 0; pid < MAX_NUMBER_OF_PROCESSES; pid++) {
+		if (*queue & WAITQUEUE_BIT(pid)) {
+			os_wakeProcess(pid);
+		}
+	}
+	*queue = 0;
+	
+	//Wiederherstellung des gespeicherten SREG
+	SREG = sreg;
+}
+
+/*!
+ *  Checks whether the stack of a process is still intact. This takes constant
+ *  time and is done by the scheduler for every process it switches out: the
+ *  saved stack pointer must lie within the stack (above the canary) and the
+ *  canary at the stack's low end must be unchanged.
+ *
+ *  \param pid The process whose stack is checked.
+ */
+static void os_checkStack(ProcessID pid) {
+	uint16_t const lowest = os_processStackBottoms[pid] - os_processStackSizes[pid] + STACK_CANARY_SIZE;
+	
+	if (os_processStackPointers[pid].as_int + 1 < lowest || !os_stackCanaryIntact(os_processStackBottoms[pid], os_processStackSizes[pid])) {
+		os_error("Stackueberlauf");
+	}
+}
+
+/*!
+ *  Returns how many bytes of its stack a process uses right now.
+ *
+ *  \param pid The process to examine.
+ *  \return The number of bytes between the stack bottom and the saved stack
+ *          pointer, or 0 if the slot is unused.
+ */
+StackSize os_getStackUsage(ProcessID pid) {
+	if (pid >= MAX_NUMBER_OF_PROCESSES || os_processStates[pid] == OS_PS_UNUSED) {
+		return 0;
+	}
+	//der laufende Prozess hat seinen Stackpointer noch nicht gesichert
+	uint16_t const sp = (pid == os_getCurrentProc()) ? SP : os_processStackPointers[pid].as_int;
+	return os_processStackBottoms[pid] - sp;
+}
+
+/*!
+ *  Returns the maximum number of bytes a process has used on its stack so far.
+ *  The painted stack is searched from its low end, so this is only computed
+ *  when it is asked for (e.g. by the task manager) and never by the scheduler.
+ *
+ *  \param pid The process to examine.
+ *  \return The stack high-water mark in bytes, or 0 if the slot is unused.
+ */
+StackSize os_getStackHighWaterMark(ProcessID pid) {
+	StackSize mark = 0;
+	
+	//der Stack darf whrend der Suche nicht freigegeben werden
+	os_enterCriticalSection();
+	if (pid < MAX_NUMBER_OF_PROCESSES && os_processStates[pid] != OS_PS_UNUSED) {
+		mark = os_stackHighWaterMark(os_processStackBottoms[pid], os_processStackSizes[pid]);
+	}
+	os_leaveCriticalSection();
+	
+	return mark;
 }
 
 /*!
@@ -417,16 +1186,31 @@ void os_leaveCriticalSection(void) {
  *  \return The checksum of the pid'th stack.
  */
 StackChecksum os_getStackChecksum(ProcessID pid) {
-	StackPointer sp;
-	StackChecksum sum;
-	//vom Boden des Stacks anfangen
-    sp.as_int = PROCESS_STACK_BOTTOM(pid);
-	sum = *(sp.as_ptr);
-	sp.as_int--;
-	//bis zum Stackpointer durchlaufen und Bytes xor verknpfen
-	while (sp.as_int > os_processes[pid].sp.as_int){
-		sum = sum ^ *(sp.as_ptr);
-		sp.as_int--;
-	}
-	return sum;
+	//vom Boden des Stacks bis zum gesicherten Stackpointer
+	return os_stackChecksum(os_processStackBottoms[pid], os_processStackPointers[pid].as_int + 1);
+}
+
+/*!
+ *  Calculates the checksum that the scheduler records when it switches a
+ *  process out and verifies when it switches the process in again. Depending
+ *  on STACK_CHECK_MODE this covers the whole used stack, only the
+ *  STACK_CHECK_WINDOW bytes above the saved stack pointer (i.e. the frame
+ *  that is restored) or nothing at all.
+ *
+ *  \param pid The process whose saved stack is checked.
+ *  \return The checksum of the checked part of the stack.
+ */
+static StackChecksum os_getSwitchChecksum(ProcessID pid) {
+#if STACK_CHECK_MODE == STACK_CHECK_FULL
+	return os_getStackChecksum(pid);
+#elif STACK_CHECK_MODE == STACK_CHECK_INCREMENTAL
+	uint16_t const low = os_processStackPointers[pid].as_int + 1;
+	uint16_t high = os_processStackPointers[pid].as_int + STACK_CHECK_WINDOW;
+	if (high > os_processStackBottoms[pid]) {
+		high = os_processStackBottoms[pid];
+	}
+	return os_stackChecksum(high, low);
+#else
+	return 0;
+#endif
 }
@@ -29,12 +29,57 @@ typedef enum SchedulingStrategy {
     OS_SS_INACTIVE_AGING
 } SchedulingStrategy;
 
+/*!
+ *  A set of processes that are blocked on the same kernel object.
+ *  Bit i is set if process i is waiting. The smallest integer type that
+ *  holds MAX_NUMBER_OF_PROCESSES bits is chosen at compile time, so wait
+ *  queues can still be tested and cleared as a whole.
+ */
+#if MAX_NUMBER_OF_PROCESSES <= 8
+typedef uint8_t WaitQueue;
+#elif MAX_NUMBER_OF_PROCESSES <= 16
+typedef uint16_t WaitQueue;
+#else
+typedef uint32_t WaitQueue;
+#endif
+
+//! The bit of a process in a WaitQueue
+#define WAITQUEUE_BIT(PID) (((WaitQueue) 1) << (PID))
+
+//----------------------------------------------------------------------------
+// Globals
+//----------------------------------------------------------------------------
+
+/*!
+ *  The process table, stored as parallel arrays indexed by the process id.
+ *  The scheduling strategies read them directly, everybody else should use
+ *  the accessor functions below.
+ */
+extern ProcessState os_processStates[MAX_NUMBER_OF_PROCESSES];
+extern Priority os_processPriorities[MAX_NUMBER_OF_PROCESSES];
+extern ProgramID os_processProgramIDs[MAX_NUMBER_OF_PROCESSES];
+
 //----------------------------------------------------------------------------
 // Function headers
 //----------------------------------------------------------------------------
 
-//! Get a pointer to the process structure by process ID
-Process* os_getProcessSlot(ProcessID pid);
+//! Get a copy of the properties of a process by process ID
+Process os_getProcessSnapshot(ProcessID pid);
+
+//! Returns the state of a process
+ProcessState os_getProcessState(ProcessID pid);
+
+//! Returns the priority of a process
+Priority os_getProcessPriority(ProcessID pid);
+
+//! Changes the priority of a process
+void os_setProcessPriority(ProcessID pid, Priority priority);
+
+//! Returns the program a process was started from
+ProgramID os_getProcessProgramID(ProcessID pid);
+
+//! Returns the stack size of a process
+StackSize os_getProcessStackSize(ProcessID pid);
 
 //! Starts the scheduler
 void os_startScheduler(void);
@@ -51,9 +96,39 @@ Program* os_lookupProgramFunction(ProgramID programID);
 //! Looks up the ID (i.e. index) of a program and returns INVALID_PROGRAM on failure
 ProgramID os_lookupProgramID(Program* program);
 
+//! Sets the stack size for processes of a program (0 for the default size)
+bool os_setProgramStackSize(ProgramID programID, StackSize size);
+
+//! Returns the stack size for processes of a program
+StackSize os_getProgramStackSize(ProgramID programID);
+
 //! Executes a process by instantiating a program
 ProcessID os_exec(ProgramID programID, Priority priority);
 
+//! Executes a process by instantiating a program and passing an argument
+ProcessID os_execWithArg(ProgramID programID, Priority priority, void* arg);
+
+//! Terminates a process
+bool os_kill(ProcessID pid);
+
+//! Terminates the current process with an exit code, only returns when called from deferred work
+void os_exit(ExitCode code);
+
+//! Waits for a process to terminate and retrieves its exit code
+bool os_join(ProcessID pid, ExitCode* code);
+
+//! Returns the number of heap bytes freed when the last process terminated
+uint16_t os_getReclaimedMemory(void);
+
+//! Stops scheduling a process until it is resumed
+bool os_suspend(ProcessID pid);
+
+//! Lets a suspended process be scheduled again
+bool os_resume(ProcessID pid);
+
+//! Checks whether a process is suspended
+bool os_isSuspended(ProcessID pid);
+
 //! Returns the number of programs
 uint8_t os_getNumberOfRegisteredPrograms(void);
 
@@ -75,6 +150,28 @@ SchedulingStrategy os_getSchedulingStrategy(void);
 //! Calculates the checksum of the stack for the corresponding process of pid.
 StackChecksum os_getStackChecksum(ProcessID pid);
 
+//! Returns the number of stack bytes currently used by a process
+StackSize os_getStackUsage(ProcessID pid);
+
+//! Returns the maximum number of stack bytes a process has used so far
+StackSize os_getStackHighWaterMark(ProcessID pid);
+
+//----------------------------------------------------------------------------
+// Blocking and wait queues
+//----------------------------------------------------------------------------
+
+//! Gives the processor to the next process
+void os_yield(void);
+
+//! Blocks the current process on a wait queue
+void os_waitQueueBlock(WaitQueue* queue);
+
+//! Wakes the most favorable process of a wait queue
+bool os_waitQueueWakeOne(WaitQueue* queue);
+
+//! Wakes all processes of a wait queue
+void os_waitQueueWakeAll(WaitQueue* queue);
+
 //----------------------------------------------------------------------------
 // Critical section management
 //----------------------------------------------------------------------------
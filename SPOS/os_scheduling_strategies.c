@@ -1,6 +1,11 @@
 #include "os_scheduling_strategies.h"
 #include "defines.h"
 
+/*
+ * The strategies read the process table directly from the parallel arrays
+ * os_processStates and os_processPriorities (see os_scheduler.h).
+ */
+
 #include <stdlib.h>
 
 /*!
@@ -31,11 +36,10 @@ void os_resetProcessSchedulingInformation(ProcessID id) {
  *  if there are other processes running other than the idle process.
  *  The idle process is executed if no other process is ready for execution
  *
- *  \param processes An array holding the processes to choose the next process from.
  *  \param current The id of the current process.
  *  \return The next process to be executed determined on the basis of the even strategy.
  */
-ProcessID os_Scheduler_Even(Process const processes[], ProcessID current) {
+ProcessID os_Scheduler_Even(ProcessID current) {
     #warning IMPLEMENT STH. HERE
 }
 
@@ -43,11 +47,10 @@ ProcessID os_Scheduler_Even(Process const processes[], ProcessID current) {
  *  This function implements the random strategy. The next process is chosen based on
  *  the result of a pseudo random number generator.
  *
- *  \param processes An array holding the processes to choose the next process from.
  *  \param current The id of the current process.
  *  \return The next process to be executed determined on the basis of the random strategy.
  */
-ProcessID os_Scheduler_Random(Process const processes[], ProcessID current) {
+ProcessID os_Scheduler_Random(ProcessID current) {
     #warning IMPLEMENT STH. HERE
 }
 
@@ -58,11 +61,10 @@ ProcessID os_Scheduler_Random(Process const processes[], ProcessID current) {
  *  and decremented each time this function is called. If the time slice reaches zero, the even
  *  strategy is used to determine the next process to run.
  *
- *  \param processes An array holding the processes to choose the next process from.
  *  \param current The id of the current process.
  *  \return The next process to be executed determined on the basis of the round robin strategy.
  */
-ProcessID os_Scheduler_RoundRobin(Process const processes[], ProcessID current) {
+ProcessID os_Scheduler_RoundRobin(ProcessID current) {
     // This is a presence task
     return 0;
 }
@@ -74,11 +76,10 @@ ProcessID os_Scheduler_RoundRobin(Process const processes[], ProcessID current)
  *  as well, the one with the lower ProcessID is chosen. Before actually returning the ProcessID, the age of the process who
  *  is to be returned is reset to its priority.
  *
- *  \param processes An array holding the processes to choose the next process from.
  *  \param current The id of the current process.
  *  \return The next process to be executed, determined based on the inactive-aging strategy.
  */
-ProcessID os_Scheduler_InactiveAging(Process const processes[], ProcessID current) {
+ProcessID os_Scheduler_InactiveAging(ProcessID current) {
     // This is a presence task
     return 0;
 }
@@ -88,11 +89,10 @@ ProcessID os_Scheduler_InactiveAging(Process const processes[], ProcessID curren
  *  As long as the process that has run before is still ready, it is returned again.
  *  If  it is not ready, the even strategy is used to determine the process to be returned
  *
- *  \param processes An array holding the processes to choose the next process from.
  *  \param current The id of the current process.
  *  \return The next process to be executed, determined based on the run-to-completion strategy.
  */
-ProcessID os_Scheduler_RunToCompletion(Process const processes[], ProcessID current) {
+ProcessID os_Scheduler_RunToCompletion(ProcessID current) {
     // This is a presence task
     return 0;
 }
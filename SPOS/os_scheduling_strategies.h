@@ -24,18 +24,18 @@ void os_resetProcessSchedulingInformation(ProcessID id);
 void os_resetSchedulingInformation(SchedulingStrategy strategy);
 
 //! Even strategy
-ProcessID os_Scheduler_Even(Process const processes[], ProcessID current);
+ProcessID os_Scheduler_Even(ProcessID current);
 
 //! Random strategy
-ProcessID os_Scheduler_Random(Process const processes[], ProcessID current);
+ProcessID os_Scheduler_Random(ProcessID current);
 
 //! RoundRobin strategy
-ProcessID os_Scheduler_RoundRobin(Process const processes[], ProcessID current);
+ProcessID os_Scheduler_RoundRobin(ProcessID current);
 
 //! InactiveAging strategy
-ProcessID os_Scheduler_InactiveAging(Process const processes[], ProcessID current);
+ProcessID os_Scheduler_InactiveAging(ProcessID current);
 
 //! RunToCompletion strategy
-ProcessID os_Scheduler_RunToCompletion(Process const processes[], ProcessID current);
+ProcessID os_Scheduler_RunToCompletion(ProcessID current);
 
 #endif
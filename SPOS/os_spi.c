@@ -0,0 +1,147 @@
+#include "os_spi.h"
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+
+/*! \file
+ *
+ * Interrupt driven SPI master. Starting a transfer selects the device and
+ * sends the first header byte, every further byte is exchanged by the SPI
+ * interrupt, which deselects the device after the last one. Hence, the CPU
+ * serves other interrupts while a transfer is running and a write can proceed
+ * while the caller does something else. As long as interrupts are disabled
+ * (e.g. while the system boots), os_spiWait exchanges the bytes itself.
+ *
+ */
+
+//! The state of the running transfer, shared with the SPI interrupt
+static struct {
+    //! The command and address bytes sent before the data
+    uint8_t header[SPI_HEADER_MAX];
+
+    //! Number of header bytes
+    uint8_t headerLength;
+
+    //! The next header byte to send
+    uint8_t headerNext;
+
+    //! Number of bytes in flight that belong to the header, their answer is discarded
+    uint8_t headerPending;
+
+    //! The next byte to send or NULL to send zeros
+    uint8_t const* tx;
+
+    //! Where the next received data byte is stored or NULL to discard it
+    uint8_t* rx;
+
+    //! Number of data bytes not sent yet
+    uint16_t txLeft;
+
+    //! Whether a transfer is in progress
+    bool busy;
+} volatile os_spi;
+
+/*!
+ *  Handles the completion of a byte. Stores the received byte and sends the
+ *  next one or ends the transfer. Must be called with interrupts disabled.
+ */
+static void os_spiStep(void) {
+    uint8_t const in = SPDR;
+
+    if (os_spi.headerPending) {
+        os_spi.headerPending--;
+    } else if (os_spi.rx) {
+        *os_spi.rx = in;
+        os_spi.rx++;
+    }
+
+    if (os_spi.headerNext < os_spi.headerLength) {
+        SPDR = os_spi.header[os_spi.headerNext++];
+    } else if (os_spi.txLeft) {
+        os_spi.txLeft--;
+        if (os_spi.tx) {
+            SPDR = *os_spi.tx;
+            os_spi.tx++;
+        } else {
+            SPDR = 0;
+        }
+    } else {
+        PORTB |= (1 << SPI_PIN_CS);
+        os_spi.busy = false;
+    }
+}
+
+//! ISR for a completed SPI byte
+ISR(SPI_STC_vect) {
+    os_spiStep();
+}
+
+/*!
+ *  Sets up the SPI as master in mode 0 at half the CPU clock and deselects
+ *  the device.
+ */
+void os_spiInit(void) {
+    PORTB |= (1 << SPI_PIN_CS);
+    DDRB |= (1 << SPI_PIN_CS) | (1 << SPI_PIN_MOSI) | (1 << SPI_PIN_SCK);
+    SPCR = (1 << SPIE) | (1 << SPE) | (1 << MSTR);
+    SPSR = (1 << SPI2X);
+    os_spi.busy = false;
+}
+
+/*!
+ *  Starts a transfer. The device is selected, the header is sent and then
+ *  length data bytes are exchanged. The function returns as soon as the
+ *  transfer is started, so both buffers must stay valid until os_spiWait
+ *  returned. A transfer that is still running is waited for before.
+ *
+ *  \param header The command and address bytes, at most SPI_HEADER_MAX. They
+ *         are copied, so the header does not need to stay valid.
+ *  \param headerLength The number of header bytes, at least one.
+ *  \param tx The data to send or NULL to send zeros.
+ *  \param rx Where the received data is stored or NULL to discard it.
+ *  \param length The number of data bytes.
+ */
+void os_spiTransfer(uint8_t const* header, uint8_t headerLength, uint8_t const* tx, uint8_t* rx, uint16_t length) {
+    os_spiWait();
+
+    for (uint8_t i = 0; i < headerLength; i++) {
+        os_spi.header[i] = header[i];
+    }
+    os_spi.headerLength = headerLength;
+    os_spi.headerNext = 1;
+    os_spi.headerPending = headerLength;
+    os_spi.tx = tx;
+    os_spi.rx = rx;
+    os_spi.txLeft = length;
+
+    uint8_t const sreg = SREG;
+    cli();
+    os_spi.busy = true;
+    PORTB &= ~(1 << SPI_PIN_CS);
+    SPDR = header[0];
+    SREG = sreg;
+}
+
+/*!
+ *  Waits until the current transfer is complete. If interrupts are disabled,
+ *  the bytes are exchanged by polling instead.
+ */
+void os_spiWait(void) {
+    while (os_spi.busy) {
+        uint8_t const sreg = SREG;
+        cli();
+        if (!(sreg & (1 << SREG_I)) && (SPSR & (1 << SPIF))) {
+            os_spiStep();
+        }
+        SREG = sreg;
+    }
+}
+
+/*!
+ *  Checks whether a transfer is in progress.
+ *
+ *  \return True if a transfer is running.
+ */
+bool os_spiBusy(void) {
+    return os_spi.busy;
+}
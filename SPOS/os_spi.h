@@ -0,0 +1,49 @@
+/*! \file
+ *  \brief Interrupt driven SPI master.
+ *
+ *  Contains the transfer layer for devices on the SPI bus, e.g. an external
+ *  SRAM. A transfer consists of a short command header followed by data that
+ *  is shifted out of and into buffers byte by byte in the SPI interrupt.
+ */
+
+#ifndef _OS_SPI_H
+#define _OS_SPI_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "defines.h"
+
+//----------------------------------------------------------------------------
+// Constants
+//----------------------------------------------------------------------------
+
+//! Maximum number of header bytes of a transfer (command and address)
+#define SPI_HEADER_MAX                  4
+
+//! The pin of port B selecting the device (the SS pin, so the SPI stays master)
+#define SPI_PIN_CS                      PB4
+
+//! The pin of port B carrying the data sent to the device
+#define SPI_PIN_MOSI                    PB5
+
+//! The pin of port B carrying the clock
+#define SPI_PIN_SCK                     PB7
+
+//----------------------------------------------------------------------------
+// Function headers
+//----------------------------------------------------------------------------
+
+//! Sets up the SPI as master at half the CPU clock and deselects the device
+void os_spiInit(void);
+
+//! Starts a transfer, waits for the previous one before
+void os_spiTransfer(uint8_t const* header, uint8_t headerLength, uint8_t const* tx, uint8_t* rx, uint16_t length);
+
+//! Waits until the current transfer is complete
+void os_spiWait(void);
+
+//! Checks whether a transfer is in progress
+bool os_spiBusy(void);
+
+#endif
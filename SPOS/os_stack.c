@@ -0,0 +1,255 @@
+#include "os_stack.h"
+#include "os_core.h"
+
+#include <avr/interrupt.h>
+
+/*! \file
+ *
+ * Best-fit allocator for process stacks. As there are never more stacks than
+ * processes, the allocated stacks are kept in a small table sorted from the
+ * bottom of the region (highest address) downwards. The free extents are the
+ * gaps between neighbouring entries, so no bookkeeping for free memory is
+ * needed and freed stacks merge with their neighbours automatically.
+ *
+ * New stacks are painted with a known pattern and get a canary at their low
+ * end. The canary is checked in O(1) on every context switch, while the
+ * high-water mark is only searched for when somebody asks for it.
+ *
+ */
+
+//! An allocated process stack
+typedef struct StackExtent {
+    //! The highest address of the stack
+    uint16_t bottom;
+
+    //! The size of the stack in bytes
+    StackSize size;
+} StackExtent;
+
+//! The allocated stacks, sorted by descending bottom address
+static StackExtent os_stackExtents[MAX_NUMBER_OF_PROCESSES];
+
+//! Number of valid entries in os_stackExtents
+static uint8_t os_stackExtentCount;
+
+/*!
+ *  Returns the highest address of the gap above (at lower addresses than) the
+ *  passed entry, i.e. the gap between entry i-1 and entry i.
+ *
+ *  \param i Index of the entry below the gap (os_stackExtentCount for the last gap).
+ *  \return The highest address of the gap.
+ */
+static uint16_t os_stackGapBottom(uint8_t i) {
+    if (i == 0) {
+        return BOTTOM_OF_PROCS_STACK;
+    }
+    return os_stackExtents[i - 1].bottom - os_stackExtents[i - 1].size;
+}
+
+/*!
+ *  Returns the size of the gap between entry i-1 and entry i.
+ *
+ *  \param i Index of the entry below the gap (os_stackExtentCount for the last gap).
+ *  \return The size of the gap in bytes.
+ */
+static StackSize os_stackGapSize(uint8_t i) {
+    uint16_t const top = (i < os_stackExtentCount) ? os_stackExtents[i].bottom + 1 : TOP_OF_PROCS_STACK;
+    return os_stackGapBottom(i) + 1 - top;
+}
+
+/*!
+ *  Allocates a process stack from the smallest gap that is large enough. The
+ *  stack is placed at the highest addresses of that gap, so the remaining free
+ *  memory stays contiguous with the next gap.
+ *  Interrupts are disabled while the table is changed.
+ *
+ *  \param size The size of the stack in bytes.
+ *  \return The bottom (highest address) of the stack, or 0 if there is no gap
+ *          large enough.
+ */
+uint16_t os_stackAlloc(StackSize size) {
+    uint8_t const sreg = SREG;
+    cli();
+
+    uint8_t best = UINT8_MAX;
+    StackSize bestSize = 0;
+    if (size && os_stackExtentCount < MAX_NUMBER_OF_PROCESSES) {
+        for (uint8_t i = 0; i <= os_stackExtentCount; i++) {
+            StackSize const gap = os_stackGapSize(i);
+            if (gap >= size && (best == UINT8_MAX || gap < bestSize)) {
+                best = i;
+                bestSize = gap;
+            }
+        }
+    }
+
+    uint16_t bottom = 0;
+    if (best != UINT8_MAX) {
+        bottom = os_stackGapBottom(best);
+        for (uint8_t i = os_stackExtentCount; i > best; i--) {
+            os_stackExtents[i] = os_stackExtents[i - 1];
+        }
+        os_stackExtents[best].bottom = bottom;
+        os_stackExtents[best].size = size;
+        os_stackExtentCount++;
+    }
+
+    SREG = sreg;
+    return bottom;
+}
+
+/*!
+ *  Frees a process stack so its memory can be reused by the next os_exec.
+ *
+ *  \param bottom The bottom of the stack as returned by os_stackAlloc.
+ */
+void os_stackFree(uint16_t bottom) {
+    uint8_t const sreg = SREG;
+    cli();
+
+    uint8_t i = 0;
+    while (i < os_stackExtentCount && os_stackExtents[i].bottom != bottom) {
+        i++;
+    }
+
+    if (i == os_stackExtentCount) {
+        os_error("Stack nicht alloziert");
+    } else {
+        os_stackExtentCount--;
+        for (; i < os_stackExtentCount; i++) {
+            os_stackExtents[i] = os_stackExtents[i + 1];
+        }
+    }
+
+    SREG = sreg;
+}
+
+/*!
+ *  Determines the size of the largest gap in the stack region.
+ *
+ *  \return The size of the largest stack os_stackAlloc would currently succeed for.
+ */
+StackSize os_stackLargestFree(void) {
+    uint8_t const sreg = SREG;
+    cli();
+
+    StackSize largest = 0;
+    for (uint8_t i = 0; i <= os_stackExtentCount; i++) {
+        StackSize const gap = os_stackGapSize(i);
+        if (gap > largest) {
+            largest = gap;
+        }
+    }
+
+    SREG = sreg;
+    return largest;
+}
+
+/*!
+ *  Returns the lowest address of a stack.
+ *
+ *  \param bottom The highest address of the stack.
+ *  \param size The size of the stack.
+ *  \return The lowest address that belongs to the stack.
+ */
+static uint8_t* os_stackTop(uint16_t bottom, StackSize size) {
+    return (uint8_t*) (bottom - size + 1);
+}
+
+/*!
+ *  Fills a whole stack with STACK_PAINT_PATTERN and writes STACK_CANARY to its
+ *  lowest bytes. This must be done before the initial context is pushed.
+ *
+ *  \param bottom The highest address of the stack.
+ *  \param size The size of the stack.
+ */
+void os_stackPaint(uint16_t bottom, StackSize size) {
+    uint8_t* const top = os_stackTop(bottom, size);
+
+    for (StackSize i = STACK_CANARY_SIZE; i < size; i++) {
+        top[i] = STACK_PAINT_PATTERN;
+    }
+    top[0] = (uint8_t) (STACK_CANARY & 0xFF);
+    top[1] = (uint8_t) (STACK_CANARY >> 8);
+}
+
+/*!
+ *  Checks the canary of a stack. This takes constant time, so it is cheap
+ *  enough to be done on every context switch. A process that grew its stack
+ *  beyond its size has most likely overwritten the canary.
+ *
+ *  \param bottom The highest address of the stack.
+ *  \param size The size of the stack.
+ *  \return True if the canary is unchanged.
+ */
+bool os_stackCanaryIntact(uint16_t bottom, StackSize size) {
+    uint8_t const* const top = os_stackTop(bottom, size);
+    return top[0] == (uint8_t) (STACK_CANARY & 0xFF) && top[1] == (uint8_t) (STACK_CANARY >> 8);
+}
+
+/*!
+ *  Determines how many bytes of a painted stack have been used at most, by
+ *  searching for the first byte above the canary that no longer holds the
+ *  paint pattern. The search starts at the low end, so it only takes as long
+ *  as the stack has never been used. A byte that happens to be written with
+ *  the pattern itself is counted as unused, so the result may be slightly too
+ *  low.
+ *
+ *  \param bottom The highest address of the stack.
+ *  \param size The size of the stack.
+ *  \return The high-water mark in bytes (not counting the canary).
+ */
+StackSize os_stackHighWaterMark(uint16_t bottom, StackSize size) {
+    uint8_t const* const top = os_stackTop(bottom, size);
+
+    StackSize unused = STACK_CANARY_SIZE;
+    while (unused < size && top[unused] == STACK_PAINT_PATTERN) {
+        unused++;
+    }
+    return size - unused;
+}
+
+/*!
+ *  Calculates the checksum of a range of stack memory with the algorithm
+ *  selected by STACK_CHECKSUM_ALGORITHM. The bytes are processed from the
+ *  highest address downwards, i.e. in the order they were pushed.
+ *
+ *  \param high The highest address of the range (e.g. the stack bottom).
+ *  \param low The lowest address of the range (e.g. the saved SP + 1).
+ *  \return The checksum of the range.
+ */
+StackChecksum os_stackChecksum(uint16_t high, uint16_t low) {
+    uint8_t const* ptr = (uint8_t const*) high;
+    uint8_t const* const end = (uint8_t const*) low;
+
+    if (high < low) {
+        return 0;
+    }
+
+#if STACK_CHECKSUM_ALGORITHM == STACK_CHECKSUM_FLETCHER
+    // Ones' complement sums, i.e. addition modulo 255 with end-around carry
+    uint8_t sum1 = 0;
+    uint8_t sum2 = 0;
+    for (;;) {
+        uint16_t t = sum1 + *ptr;
+        sum1 = (uint8_t) t + (uint8_t) (t >> 8);
+        t = sum2 + sum1;
+        sum2 = (uint8_t) t + (uint8_t) (t >> 8);
+        if (ptr == end) {
+            break;
+        }
+        ptr--;
+    }
+    return ((StackChecksum) sum2 << 8) | sum1;
+#else
+    StackChecksum sum = 0;
+    for (;;) {
+        sum ^= *ptr;
+        if (ptr == end) {
+            break;
+        }
+        ptr--;
+    }
+    return sum;
+#endif
+}
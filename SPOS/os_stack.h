@@ -0,0 +1,42 @@
+/*! \file
+ *  \brief Allocator for process stacks.
+ *
+ *  Contains a best-fit allocator that carves process stacks of individual
+ *  sizes out of the memory region reserved for them.
+ */
+
+#ifndef _OS_STACK_H
+#define _OS_STACK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "defines.h"
+#include "os_process.h"
+
+//----------------------------------------------------------------------------
+// Function headers
+//----------------------------------------------------------------------------
+
+//! Allocates a process stack and returns its bottom (highest address) or 0 on failure
+uint16_t os_stackAlloc(StackSize size);
+
+//! Frees the process stack with the passed bottom
+void os_stackFree(uint16_t bottom);
+
+//! Returns the size of the largest stack that can currently be allocated
+StackSize os_stackLargestFree(void);
+
+//! Paints a stack with STACK_PAINT_PATTERN and places the canary at its low end
+void os_stackPaint(uint16_t bottom, StackSize size);
+
+//! Checks whether the canary at the low end of a stack is unchanged
+bool os_stackCanaryIntact(uint16_t bottom, StackSize size);
+
+//! Returns the maximum number of bytes that have been used on a painted stack
+StackSize os_stackHighWaterMark(uint16_t bottom, StackSize size);
+
+//! Calculates the checksum of the stack bytes from high down to low (inclusive)
+StackChecksum os_stackChecksum(uint16_t high, uint16_t low);
+
+#endif
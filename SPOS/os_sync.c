@@ -0,0 +1,362 @@
+#include "os_sync.h"
+#include "os_scheduler.h"
+#include "os_core.h"
+
+#include <avr/interrupt.h>
+
+/*! \file
+ *
+ * Mutexes, condition variables and reader-writer locks. The state of each
+ * object is only touched with interrupts disabled for a few cycles, so the
+ * scheduler keeps running. Processes that have to wait are blocked on the
+ * wait queue of the object and are woken up by the releasing process.
+ *
+ */
+
+//! For every process the list of mutexes it holds, so they can be released on termination.
+static Mutex* os_heldMutexes[MAX_NUMBER_OF_PROCESSES];
+
+//! For every process the list of reader-writer locks it holds for writing.
+static RWLock* os_heldWriteLocks[MAX_NUMBER_OF_PROCESSES];
+
+//! For every process the reader-writer lock it waits for to write (NULL if none).
+static RWLock* os_awaitedWriteLocks[MAX_NUMBER_OF_PROCESSES];
+
+/*!
+ *  Makes the current process the owner of a free mutex. Must be called with
+ *  interrupts disabled.
+ *
+ *  \param mutex The mutex to take.
+ */
+static void os_mutexTake(Mutex* mutex) {
+    ProcessID const pid = os_getCurrentProc();
+    mutex->owner = pid;
+    if (pid < MAX_NUMBER_OF_PROCESSES) {
+        mutex->nextHeld = os_heldMutexes[pid];
+        os_heldMutexes[pid] = mutex;
+    }
+}
+
+/*!
+ *  Frees a mutex and wakes the most favorable waiting process. Must be called
+ *  with interrupts disabled.
+ *
+ *  \param mutex The mutex to give up.
+ */
+static void os_mutexGive(Mutex* mutex) {
+    if (mutex->owner < MAX_NUMBER_OF_PROCESSES) {
+        Mutex** link = &os_heldMutexes[mutex->owner];
+        while (*link && *link != mutex) {
+            link = &(*link)->nextHeld;
+        }
+        if (*link) {
+            *link = mutex->nextHeld;
+        }
+    }
+    mutex->owner = INVALID_PROCESS;
+    mutex->nextHeld = NULL;
+    os_waitQueueWakeOne(&mutex->waiting);
+}
+
+/*!
+ *  Initializes a mutex as free. Statically allocated mutexes may use
+ *  MUTEX_INITIALIZER instead.
+ *
+ *  \param mutex The mutex to initialize.
+ */
+void os_mutexInit(Mutex* mutex) {
+    mutex->owner = INVALID_PROCESS;
+    mutex->waiting = 0;
+    mutex->nextHeld = NULL;
+}
+
+/*!
+ *  Acquires the mutex for the current process. If it is held by another
+ *  process, the current process is blocked until the mutex is released.
+ *  Mutexes are not recursive, locking a mutex twice is an error.
+ *
+ *  \param mutex The mutex to acquire.
+ */
+void os_mutexLock(Mutex* mutex) {
+    uint8_t const sreg = SREG;
+    cli();
+
+    if (mutex->owner == os_getCurrentProc()) {
+        os_error("Mutex doppelt gesperrt");
+        SREG = sreg;
+        return;
+    }
+
+    while (mutex->owner != INVALID_PROCESS) {
+        os_waitQueueBlock(&mutex->waiting);
+    }
+    os_mutexTake(mutex);
+
+    SREG = sreg;
+}
+
+/*!
+ *  Acquires the mutex for the current process if it is free.
+ *
+ *  \param mutex The mutex to acquire.
+ *  \return True if the mutex was acquired.
+ */
+bool os_mutexTryLock(Mutex* mutex) {
+    uint8_t const sreg = SREG;
+    cli();
+
+    bool const success = (mutex->owner == INVALID_PROCESS);
+    if (success) {
+        os_mutexTake(mutex);
+    }
+
+    SREG = sreg;
+    return success;
+}
+
+/*!
+ *  Releases the mutex. Only the owner may release a mutex. The most
+ *  favorable waiting process (if any) is woken up and competes for it.
+ *
+ *  \param mutex The mutex to release.
+ */
+void os_mutexUnlock(Mutex* mutex) {
+    uint8_t const sreg = SREG;
+    cli();
+
+    if (mutex->owner != os_getCurrentProc()) {
+        os_error("Mutex nicht gesperrt");
+    } else {
+        os_mutexGive(mutex);
+    }
+
+    SREG = sreg;
+}
+
+/*!
+ *  Releases all mutexes held by the passed process. This is used by os_kill,
+ *  so processes waiting for such a mutex are not blocked forever.
+ *
+ *  \param pid The process whose mutexes are released.
+ */
+void os_releaseMutexes(ProcessID pid) {
+    uint8_t const sreg = SREG;
+    cli();
+
+    while (os_heldMutexes[pid]) {
+        os_mutexGive(os_heldMutexes[pid]);
+    }
+
+    SREG = sreg;
+}
+
+/*!
+ *  Initializes a condition variable. Statically allocated condition variables
+ *  may use CONDVAR_INITIALIZER instead.
+ *
+ *  \param cond The condition variable to initialize.
+ */
+void os_condInit(CondVar* cond) {
+    cond->waiting = 0;
+}
+
+/*!
+ *  Releases the mutex and blocks the current process until the condition is
+ *  signaled. Releasing and blocking happen atomically, so a signal sent after
+ *  the mutex was released cannot be missed. The mutex is reacquired before
+ *  this function returns. As another process may have changed the protected
+ *  state in between, the condition should be rechecked in a loop.
+ *
+ *  \param cond The condition variable to wait for.
+ *  \param mutex The mutex protecting the condition. Must be held by the caller.
+ */
+void os_condWait(CondVar* cond, Mutex* mutex) {
+    uint8_t const sreg = SREG;
+    cli();
+
+    os_mutexUnlock(mutex);
+    os_waitQueueBlock(&cond->waiting);
+
+    SREG = sreg;
+    os_mutexLock(mutex);
+}
+
+/*!
+ *  Wakes the most favorable process waiting for the condition.
+ *
+ *  \param cond The condition variable to signal.
+ */
+void os_condSignal(CondVar* cond) {
+    os_waitQueueWakeOne(&cond->waiting);
+}
+
+/*!
+ *  Wakes all processes waiting for the condition.
+ *
+ *  \param cond The condition variable to signal.
+ */
+void os_condBroadcast(CondVar* cond) {
+    os_waitQueueWakeAll(&cond->waiting);
+}
+
+/*!
+ *  Initializes a reader-writer lock as free. Statically allocated locks may use
+ *  RWLOCK_INITIALIZER instead.
+ *
+ *  \param lock The lock to initialize.
+ */
+void os_rwLockInit(RWLock* lock) {
+    lock->readers = 0;
+    lock->writer = INVALID_PROCESS;
+    lock->readQueue = 0;
+    lock->writeQueue = 0;
+    lock->nextHeld = NULL;
+}
+
+/*!
+ *  Passes a lock without writer on. A waiting writer is preferred, if there
+ *  is none all waiting readers are admitted at once. While readers hold the
+ *  lock, the last of them wakes the writer instead. Must be called with
+ *  interrupts disabled.
+ *
+ *  \param lock The lock to pass on.
+ */
+static void os_rwPassOn(RWLock* lock) {
+    if (lock->writeQueue) {
+        if (!lock->readers) {
+            os_waitQueueWakeOne(&lock->writeQueue);
+        }
+    } else {
+        os_waitQueueWakeAll(&lock->readQueue);
+    }
+}
+
+/*!
+ *  Acquires the lock for reading. The current process is blocked while a
+ *  writer holds the lock or waits for it (writer preference).
+ *
+ *  \param lock The lock to acquire.
+ */
+void os_rwLockRead(RWLock* lock) {
+    uint8_t const sreg = SREG;
+    cli();
+
+    while (lock->writer != INVALID_PROCESS || lock->writeQueue) {
+        os_waitQueueBlock(&lock->readQueue);
+    }
+    if (lock->readers == UINT8_MAX) {
+        os_error("Zu viele Leser");
+    } else {
+        lock->readers++;
+    }
+
+    SREG = sreg;
+}
+
+/*!
+ *  Releases the lock held for reading. The last reader hands the lock to a
+ *  waiting writer.
+ *
+ *  \param lock The lock to release.
+ */
+void os_rwUnlockRead(RWLock* lock) {
+    uint8_t const sreg = SREG;
+    cli();
+
+    if (!lock->readers) {
+        os_error("Leselock nicht gehalten");
+    } else if (!--lock->readers) {
+        os_waitQueueWakeOne(&lock->writeQueue);
+    }
+
+    SREG = sreg;
+}
+
+/*!
+ *  Acquires the lock for writing. The current process is blocked while any
+ *  reader or another writer holds the lock. While it waits, new readers are
+ *  held back.
+ *
+ *  \param lock The lock to acquire.
+ */
+void os_rwLockWrite(RWLock* lock) {
+    uint8_t const sreg = SREG;
+    cli();
+
+    ProcessID const pid = os_getCurrentProc();
+    while (lock->writer != INVALID_PROCESS || lock->readers) {
+        if (pid < MAX_NUMBER_OF_PROCESSES) {
+            os_awaitedWriteLocks[pid] = lock;
+        }
+        os_waitQueueBlock(&lock->writeQueue);
+    }
+    lock->writer = pid;
+    if (pid < MAX_NUMBER_OF_PROCESSES) {
+        os_awaitedWriteLocks[pid] = NULL;
+        lock->nextHeld = os_heldWriteLocks[pid];
+        os_heldWriteLocks[pid] = lock;
+    }
+
+    SREG = sreg;
+}
+
+/*!
+ *  Releases the lock held for writing. Waiting writers are preferred, if there
+ *  are none all waiting readers are admitted at once.
+ *
+ *  \param lock The lock to release.
+ */
+void os_rwUnlockWrite(RWLock* lock) {
+    uint8_t const sreg = SREG;
+    cli();
+
+    if (lock->writer != os_getCurrentProc()) {
+        os_error("Schreiblock nicht gehalten");
+    } else {
+        if (lock->writer < MAX_NUMBER_OF_PROCESSES) {
+            RWLock** link = &os_heldWriteLocks[lock->writer];
+            while (*link && *link != lock) {
+                link = &(*link)->nextHeld;
+            }
+            if (*link) {
+                *link = lock->nextHeld;
+            }
+        }
+        lock->writer = INVALID_PROCESS;
+        lock->nextHeld = NULL;
+        os_rwPassOn(lock);
+    }
+
+    SREG = sreg;
+}
+
+/*!
+ *  Releases all reader-writer locks the passed process holds for writing.
+ *  If it waited to write, possibly already woken up, the lock it waited for
+ *  is passed on if it is free. Otherwise readers that were held back by the
+ *  waiting writer, or writers behind it, would wait forever. This is used by
+ *  os_kill after the process was removed from its wait queue. Locks held for
+ *  reading are not tracked and thus not released.
+ *
+ *  \param pid The process whose locks are released.
+ */
+void os_releaseRWLocks(ProcessID pid) {
+    uint8_t const sreg = SREG;
+    cli();
+
+    while (os_heldWriteLocks[pid]) {
+        RWLock* const lock = os_heldWriteLocks[pid];
+        os_heldWriteLocks[pid] = lock->nextHeld;
+        lock->writer = INVALID_PROCESS;
+        lock->nextHeld = NULL;
+        os_rwPassOn(lock);
+    }
+
+    RWLock* const awaited = os_awaitedWriteLocks[pid];
+    os_awaitedWriteLocks[pid] = NULL;
+    if (awaited && awaited->writer == INVALID_PROCESS) {
+        os_rwPassOn(awaited);
+    }
+
+    SREG = sreg;
+}
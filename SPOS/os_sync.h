@@ -0,0 +1,121 @@
+/*! \file
+ *  \brief Synchronization primitives for processes.
+ *
+ *  Contains mutexes, condition variables and reader-writer locks. All of them
+ *  block waiting processes on kernel wait queues instead of spinning.
+ */
+
+#ifndef _OS_SYNC_H
+#define _OS_SYNC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "defines.h"
+#include "os_scheduler.h"
+
+//----------------------------------------------------------------------------
+// Types
+//----------------------------------------------------------------------------
+
+//! A mutual exclusion lock that is owned by at most one process.
+typedef struct Mutex {
+    //! The process holding the mutex or INVALID_PROCESS if it is free.
+    ProcessID owner;
+
+    //! Processes waiting for the mutex.
+    WaitQueue waiting;
+
+    //! The next mutex held by the same owner.
+    struct Mutex* nextHeld;
+} Mutex;
+
+//! A condition variable. It is always used together with a Mutex.
+typedef struct CondVar {
+    //! Processes waiting for the condition to be signaled.
+    WaitQueue waiting;
+} CondVar;
+
+/*!
+ *  A reader-writer lock with writer preference. Any number of readers may
+ *  hold the lock at the same time, while a writer holds it exclusively.
+ *  As soon as a writer waits, no new readers are admitted. If a writer is
+ *  killed while it waits or holds the lock, the lock is passed on, so readers
+ *  and other writers are not held back forever.
+ */
+typedef struct RWLock {
+    //! Number of processes currently holding the lock for reading.
+    uint8_t readers;
+
+    //! The process holding the lock for writing or INVALID_PROCESS.
+    ProcessID writer;
+
+    //! Readers waiting for the lock.
+    WaitQueue readQueue;
+
+    //! Writers waiting for the lock.
+    WaitQueue writeQueue;
+
+    //! The next lock held for writing by the same writer.
+    struct RWLock* nextHeld;
+} RWLock;
+
+//! Static initializer for a free mutex
+#define MUTEX_INITIALIZER { .owner = INVALID_PROCESS, .waiting = 0, .nextHeld = NULL }
+
+//! Static initializer for a condition variable
+#define CONDVAR_INITIALIZER { .waiting = 0 }
+
+//! Static initializer for a free reader-writer lock
+#define RWLOCK_INITIALIZER { .readers = 0, .writer = INVALID_PROCESS, .readQueue = 0, .writeQueue = 0, .nextHeld = NULL }
+
+//----------------------------------------------------------------------------
+// Function headers
+//----------------------------------------------------------------------------
+
+//! Initializes a mutex as free
+void os_mutexInit(Mutex* mutex);
+
+//! Acquires a mutex and blocks while it is held by another process
+void os_mutexLock(Mutex* mutex);
+
+//! Acquires a mutex if it is free, never blocks
+bool os_mutexTryLock(Mutex* mutex);
+
+//! Releases a mutex held by the current process
+void os_mutexUnlock(Mutex* mutex);
+
+//! Releases all mutexes held by a process (used on termination)
+void os_releaseMutexes(ProcessID pid);
+
+//! Initializes a condition variable
+void os_condInit(CondVar* cond);
+
+//! Atomically releases the mutex and waits for the condition
+void os_condWait(CondVar* cond, Mutex* mutex);
+
+//! Wakes one process waiting for the condition
+void os_condSignal(CondVar* cond);
+
+//! Wakes all processes waiting for the condition
+void os_condBroadcast(CondVar* cond);
+
+//! Initializes a reader-writer lock as free
+void os_rwLockInit(RWLock* lock);
+
+//! Acquires a reader-writer lock for reading
+void os_rwLockRead(RWLock* lock);
+
+//! Releases a reader-writer lock held for reading
+void os_rwUnlockRead(RWLock* lock);
+
+//! Acquires a reader-writer lock for writing
+void os_rwLockWrite(RWLock* lock);
+
+//! Releases a reader-writer lock held for writing
+void os_rwUnlockWrite(RWLock* lock);
+
+//! Releases the write locks of a process and passes on the lock it waits for (used on termination)
+void os_releaseRWLocks(ProcessID pid);
+
+#endif
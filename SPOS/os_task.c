@@ -0,0 +1,241 @@
+#include "os_task.h"
+#include "os_deferred.h"
+
+#include <avr/interrupt.h>
+
+/*! \file
+ *
+ * Lightweight tasks. Ready tasks wait in a FIFO queue. As soon as it is not
+ * empty, a runner job is handed to the deferred work queue, so the tasks run
+ * on the scheduler's stack right before the next process is chosen (with
+ * interrupts enabled, but without process switches). Sleeping tasks are kept
+ * in a delta list like the software timers.
+ * As all tasks share one stack and one runner, a task function must never
+ * block or busy-wait. It has to return at a yield point instead.
+ *
+ */
+
+//! The first ready task, it runs next.
+static Task* os_taskReadyHead;
+
+//! The last ready task.
+static Task* os_taskReadyTail;
+
+//! The sleeping task that wakes up next (delta list).
+static Task* os_taskSleeping;
+
+//! Whether the runner is already in the deferred work queue.
+static bool os_taskRunnerQueued;
+
+static void os_taskRun(void* arg);
+
+/*!
+ *  Hands the runner to the deferred work queue if there are ready tasks and
+ *  it is not queued yet. If the deferred work queue is full, the next tick
+ *  tries again. Must be called with interrupts disabled.
+ */
+static void os_taskRequestRunner(void) {
+    if (os_taskReadyHead && !os_taskRunnerQueued) {
+        os_taskRunnerQueued = os_deferWork(os_taskRun, NULL);
+    }
+}
+
+/*!
+ *  Appends a task to the ready queue. Must be called with interrupts disabled.
+ *
+ *  \param task The task to make ready.
+ */
+static void os_taskMakeReady(Task* task) {
+    task->next = NULL;
+    task->state = TASK_STATE_READY;
+    if (os_taskReadyTail) {
+        os_taskReadyTail->next = task;
+    } else {
+        os_taskReadyHead = task;
+    }
+    os_taskReadyTail = task;
+    os_taskRequestRunner();
+}
+
+/*!
+ *  The runner job. Runs at most TASK_RUN_BUDGET ready tasks, then requeues
+ *  itself if there are still ready tasks, so processes are not held up for
+ *  long by a busy set of tasks.
+ *
+ *  \param arg Unused.
+ */
+static void os_taskRun(void* arg) {
+    for (uint8_t budget = TASK_RUN_BUDGET; budget; budget--) {
+        uint8_t sreg = SREG;
+        cli();
+        Task* const task = os_taskReadyHead;
+        if (task) {
+            os_taskReadyHead = task->next;
+            if (!os_taskReadyHead) {
+                os_taskReadyTail = NULL;
+            }
+            task->state = TASK_STATE_RUNNING;
+        }
+        SREG = sreg;
+
+        if (!task) {
+            break;
+        }
+
+        switch (task->function(task)) {
+            case TASK_YIELDED:
+                sreg = SREG;
+                cli();
+                os_taskMakeReady(task);
+                SREG = sreg;
+                break;
+            case TASK_EXITED:
+                task->state = TASK_STATE_FINISHED;
+                break;
+            default:
+                // The task is in the sleep list or waits for an event
+                break;
+        }
+    }
+
+    uint8_t const sreg = SREG;
+    cli();
+    os_taskRunnerQueued = false;
+    os_taskRequestRunner();
+    SREG = sreg;
+}
+
+/*!
+ *  Starts a task. It is appended to the ready queue and run by the scheduler
+ *  from the beginning of its function.
+ *
+ *  \param task The task to start. Must not be started already.
+ *  \param function The function of the task.
+ *  \return True on success, false if the task is still running.
+ */
+bool os_taskStart(Task* task, TaskFunction* function) {
+    uint8_t const sreg = SREG;
+    cli();
+
+    bool const idle = (task->state == TASK_STATE_IDLE || task->state == TASK_STATE_FINISHED);
+    if (idle) {
+        task->function = function;
+        task->lc = 0;
+        os_taskMakeReady(task);
+    }
+
+    SREG = sreg;
+    return idle;
+}
+
+/*!
+ *  Checks whether a task has finished, i.e. reached TASK_END or TASK_EXIT.
+ *
+ *  \param task The task to examine.
+ *  \return True if the task has finished.
+ */
+bool os_taskIsFinished(Task const* task) {
+    return task->state == TASK_STATE_FINISHED;
+}
+
+/*!
+ *  Inserts a task into the sleep list. This is used by TASK_WAIT_TICKS and
+ *  must only be called by the running task itself.
+ *
+ *  \param task The task to put to sleep.
+ *  \param ticks Scheduler ticks until the task becomes ready again.
+ */
+void os_taskSleep(Task* task, TimerTicks ticks) {
+    uint8_t const sreg = SREG;
+    cli();
+
+    if (!ticks) {
+        os_taskMakeReady(task);
+    } else {
+        Task** link = &os_taskSleeping;
+        while (*link && (*link)->delta <= ticks) {
+            ticks -= (*link)->delta;
+            link = &(*link)->next;
+        }
+        task->delta = ticks;
+        task->next = *link;
+        if (*link) {
+            (*link)->delta -= ticks;
+        }
+        *link = task;
+        task->state = TASK_STATE_SLEEPING;
+    }
+
+    SREG = sreg;
+}
+
+/*!
+ *  Makes a task wait for an event. This is used by TASK_WAIT_EVENT and must
+ *  only be called by the running task itself.
+ *
+ *  \param task The task that waits.
+ *  \param event The event to wait for.
+ */
+void os_taskWait(Task* task, TaskEvent* event) {
+    uint8_t const sreg = SREG;
+    cli();
+
+    task->next = event->waiting;
+    event->waiting = task;
+    task->state = TASK_STATE_WAITING;
+
+    SREG = sreg;
+}
+
+/*!
+ *  Initializes an event without waiting tasks. Statically allocated events
+ *  may use TASK_EVENT_INITIALIZER instead.
+ *
+ *  \param event The event to initialize.
+ */
+void os_taskEventInit(TaskEvent* event) {
+    event->waiting = NULL;
+}
+
+/*!
+ *  Makes all tasks waiting for an event ready. This may be called from
+ *  processes, tasks and ISRs.
+ *
+ *  \param event The event to signal.
+ */
+void os_taskEventSignal(TaskEvent* event) {
+    uint8_t const sreg = SREG;
+    cli();
+
+    Task* task = event->waiting;
+    event->waiting = NULL;
+    while (task) {
+        Task* const next = task->next;
+        os_taskMakeReady(task);
+        task = next;
+    }
+
+    SREG = sreg;
+}
+
+/*!
+ *  Advances the sleeping tasks by the passed number of ticks and makes the
+ *  tasks that are due ready. Must only be called by the scheduler.
+ *
+ *  \param ticks The number of ticks that have passed.
+ */
+void os_taskTick(uint8_t ticks) {
+    while (os_taskSleeping) {
+        Task* const task = os_taskSleeping;
+        if (task->delta > ticks) {
+            task->delta -= ticks;
+            break;
+        }
+        ticks -= task->delta;
+        os_taskSleeping = task->next;
+        os_taskMakeReady(task);
+    }
+
+    // Retry if the deferred work queue was full before
+    os_taskRequestRunner();
+}
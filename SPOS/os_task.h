@@ -0,0 +1,150 @@
+/*! \file
+ *  \brief Lightweight tasks for the OS.
+ *
+ *  Contains stackless, protothread-style tasks. A task is a function that
+ *  runs to completion every time it is called and remembers where to go on
+ *  with in a local continuation. Ready tasks are run by the scheduler on its
+ *  own stack, so a task only costs its Task structure instead of a process
+ *  stack and context.
+ */
+
+#ifndef _OS_TASK_H
+#define _OS_TASK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "defines.h"
+#include "os_timer.h"
+
+//----------------------------------------------------------------------------
+// Types
+//----------------------------------------------------------------------------
+
+//! What a task function reports when it returns to the kernel.
+typedef enum TaskResult {
+    TASK_YIELDED,   //!< The task wants to run again as soon as possible.
+    TASK_WAITING,   //!< The task waits for a timer or an event.
+    TASK_EXITED     //!< The task has finished.
+} TaskResult;
+
+//! The state a task is in.
+typedef enum TaskState {
+    TASK_STATE_IDLE,
+    TASK_STATE_READY,
+    TASK_STATE_RUNNING,
+    TASK_STATE_SLEEPING,
+    TASK_STATE_WAITING,
+    TASK_STATE_FINISHED
+} TaskState;
+
+struct Task;
+
+//! This is the type of a task function (not the pointer to one!).
+typedef TaskResult (TaskFunction)(struct Task* task);
+
+/*!
+ *  A lightweight task. A task is always in at most one list (ready queue,
+ *  sleep list or the list of an event), so a single link suffices.
+ *  Task functions do not keep local variables across yield points. State that
+ *  has to survive is kept in static variables or in a structure that embeds
+ *  the Task as its first member.
+ *  The memory of a task must stay valid until it has finished.
+ */
+typedef struct Task {
+    //! The next task in the list the task is in.
+    struct Task* next;
+
+    //! The function of the task.
+    TaskFunction* function;
+
+    //! The local continuation, i.e. the line to go on with (0 at the start).
+    uint16_t lc;
+
+    //! Ticks after the predecessor in the sleep list.
+    TimerTicks delta;
+
+    //! The state of the task.
+    TaskState state;
+} Task;
+
+//! An event lightweight tasks can wait for.
+typedef struct TaskEvent {
+    //! The tasks waiting for the event.
+    Task* waiting;
+} TaskEvent;
+
+//! Static initializer for an event
+#define TASK_EVENT_INITIALIZER { .waiting = NULL }
+
+//----------------------------------------------------------------------------
+// Macros
+//----------------------------------------------------------------------------
+
+/*!
+ *  Starts the body of a task function. Each yield point stores its line
+ *  number in the local continuation and returns, the switch jumps back there
+ *  on the next call. Hence, yield points must not be used inside a switch
+ *  statement of the task function itself.
+ *  Use the macros in this fashion:
+ *
+ *    static TaskResult blink(Task* task) {
+ *        TASK_BEGIN(task);
+ *        while (1) {
+ *            PORTB ^= 1;
+ *            TASK_WAIT_TICKS(task, TIMER_MS_TO_TICKS(500));
+ *        }
+ *        TASK_END(task);
+ *    }
+ */
+#define TASK_BEGIN(task) switch ((task)->lc) { case 0:
+
+//! Ends the body of a task function, the task is finished when it gets here.
+#define TASK_END(task) } (task)->lc = 0; return TASK_EXITED
+
+//! Yield point: lets other tasks run and goes on as soon as possible.
+#define TASK_YIELD(task) \
+    do { (task)->lc = __LINE__; return TASK_YIELDED; case __LINE__:; } while (0)
+
+//! Yield point: goes on after the passed number of scheduler ticks.
+#define TASK_WAIT_TICKS(task, ticks) \
+    do { (task)->lc = __LINE__; os_taskSleep((task), (ticks)); return TASK_WAITING; case __LINE__:; } while (0)
+
+//! Yield point: goes on after the event has been signaled.
+#define TASK_WAIT_EVENT(task, event) \
+    do { (task)->lc = __LINE__; os_taskWait((task), (event)); return TASK_WAITING; case __LINE__:; } while (0)
+
+//! Yields until the condition holds. The condition is rechecked whenever the task runs.
+#define TASK_WAIT_UNTIL(task, condition) \
+    while (!(condition)) TASK_YIELD(task)
+
+//! Finishes the task right away.
+#define TASK_EXIT(task) \
+    do { (task)->lc = 0; return TASK_EXITED; } while (0)
+
+//----------------------------------------------------------------------------
+// Function headers
+//----------------------------------------------------------------------------
+
+//! Starts a task, it is run by the scheduler soon
+bool os_taskStart(Task* task, TaskFunction* function);
+
+//! Checks whether a task has finished
+bool os_taskIsFinished(Task const* task);
+
+//! Puts a task to sleep (used by TASK_WAIT_TICKS)
+void os_taskSleep(Task* task, TimerTicks ticks);
+
+//! Makes a task wait for an event (used by TASK_WAIT_EVENT)
+void os_taskWait(Task* task, TaskEvent* event);
+
+//! Initializes an event
+void os_taskEventInit(TaskEvent* event);
+
+//! Wakes all tasks waiting for an event (callable from ISRs)
+void os_taskEventSignal(TaskEvent* event);
+
+//! Advances the sleeping tasks (scheduler only)
+void os_taskTick(uint8_t ticks);
+
+#endif
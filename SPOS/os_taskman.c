@@ -37,14 +37,17 @@ Page specification;
 #include "os_scheduler.h"
 #include "os_input.h"
 #include "os_user_privileges.h"
-#if (VERSUCH >= 3)
+#if HEAP_SUPPORT
     #include "os_memory.h"
+    #include "os_memory_strategies.h"
+#endif
+#if POST_SUPPORT
+    #include "os_post.h"
 #endif
 
 #pragma GCC push_options
 #pragma GCC optimize ("O3")
 
-Process* os_getProcessSlot(ProcessID);
 Program** os_getProgramSlot(ProgramID);
 
 /* END OF INTERFACE DECLS ************************/
@@ -62,6 +65,11 @@ Program** os_getProgramSlot(ProgramID);
  */
 #define TM_COMPILE_KILL_SUPPORT (VERSUCH >= 3)
 
+/*!
+ *  Does the OS know how to suspend and resume a process?
+ */
+#define TM_COMPILE_SUSPEND_SUPPORT (VERSUCH >= 2)
+
 /*!
  *  Does the OS know what the priority of a process is?
  *  This should be implemented in exercise 3.
@@ -78,7 +86,12 @@ Program** os_getProgramSlot(ProgramID);
  *  Used to deactivate the support for the memory drivers.
  *  Set this to 1 if you have implemented the memory part of SPOS.
  */
-#define TM_COMPILE_HEAP_SUPPORT (VERSUCH >= 3)
+#define TM_COMPILE_HEAP_SUPPORT HEAP_SUPPORT
+
+/*!
+ *  Does the OS paint process stacks, so their usage can be shown?
+ */
+#define TM_COMPILE_STACK_SUPPORT (VERSUCH >= 2)
 
 /*!
  *  The number of main-pages of the TM. Actually, this is set by
@@ -437,9 +450,11 @@ char PROGMEM const mainLabels[] =
     "-~= TaskMan =~-                \0"
     "Start Program                  \0"
     "Kill Process                   \0"
+    "Suspend/Resume Process         \0"
     "Change Priority                \0"
     "Change Scheduling Strategy     \0"
-    "Heap(s)                        \0";
+    "Heap(s)                        \0"
+    "Stack Usage                    \0";
 
 // Forward declarations for the sub-pages of the root-page.
 static tm_page tm_frontpage;
@@ -449,6 +464,10 @@ static tm_page tm_startProg;
     static tm_page tm_killProc;
 #endif
 
+#if TM_COMPILE_SUSPEND_SUPPORT
+    static tm_page tm_suspendProc;
+#endif
+
 #if TM_COMPILE_PRIORITY_SUPPORT
     static tm_page tm_priority;
 #endif
@@ -461,6 +480,10 @@ static tm_page tm_startProg;
     static tm_page tm_heap;
 #endif
 
+#if TM_COMPILE_STACK_SUPPORT
+    static tm_page tm_stack;
+#endif
+
 static tm_page tm_null;
 
 // A convenience macro to access the stack-history.
@@ -483,7 +506,7 @@ static tm_page tm_null;
 #endif
 
 #if TM_COMPILE_HEAP_SUPPORT
-    #define MS_MAX_COUNT (MAX4(OS_MEM_FIRST, OS_MEM_NEXT, OS_MEM_BEST, OS_MEM_WORST) + 1)
+    #define MS_MAX_COUNT (MAX5(OS_MEM_FIRST, OS_MEM_NEXT, OS_MEM_BEST, OS_MEM_WORST, OS_MEM_TLSF) + 1)
 #endif
 
 /*!
@@ -511,14 +534,20 @@ static TM_PAGE(tm_rootpage) {
 #if TM_COMPILE_KILL_SUPPORT
         SUBP(2, tm_killProc, os_getCurrentProc(), MAX_NUMBER_OF_PROCESSES)
 #endif
+#if TM_COMPILE_SUSPEND_SUPPORT
+        SUBP(3, tm_suspendProc, os_getCurrentProc(), MAX_NUMBER_OF_PROCESSES)
+#endif
 #if TM_COMPILE_PRIORITY_SUPPORT
-        SUBP(3, tm_priority, os_getCurrentProc(), MAX_NUMBER_OF_PROCESSES)
+        SUBP(4, tm_priority, os_getCurrentProc(), MAX_NUMBER_OF_PROCESSES)
 #endif
 #if TM_COMPILE_SCHEDULING_SUPPORT
-        SUBP(4, tm_scheduling, os_getSchedulingStrategy(), SS_MAX_COUNT)
+        SUBP(5, tm_scheduling, os_getSchedulingStrategy(), SS_MAX_COUNT)
 #endif
 #if TM_COMPILE_HEAP_SUPPORT
-        SUBP(5, tm_heap, 0, TM_HEAP_SUPPORT)
+        SUBP(6, tm_heap, 0, TM_HEAP_SUPPORT)
+#endif
+#if TM_COMPILE_STACK_SUPPORT
+        SUBP(7, tm_stack, os_getCurrentProc(), MAX_NUMBER_OF_PROCESSES)
 #endif
 #undef SUBP
         default:
@@ -634,13 +663,29 @@ make_pagehandler(tm_frontpage, tm_null, 0, 0, OS_PR_FRONTPAGE, null, 0) {
     return true;
 }
 
+/*!
+ *  Checks whether a program belongs to the OS itself, like the worker of
+ *  os_post. Such programs are neither offered for starting nor can their
+ *  processes be killed, as a second or a missing instance breaks the OS.
+ *  \param program The program to check.
+ *  \returns Whether the program is hidden from the user.
+ */
+static bool tm_isSystemProgram(ProgramID program) {
+#if POST_SUPPORT
+    return program == os_getPostWorkerProgram();
+#else
+    (void)program;
+    return false;
+#endif
+}
+
 /*!
  *  This page allows you to select a program (!) and then
  *  execute this program (i.e. make a process of it).
  */
 make_pagehandler(tm_startProg, tm_startProg_exec, 0, 1, OS_PR_START_PROG_SELECT, null, 0) {
     uint16_t const page = peekStack(0).param;
-    if (!*os_getProgramSlot(page)) {
+    if (!*os_getProgramSlot(page) || tm_isSystemProgram(page)) {
         return false;
     }
     lcd_writeProgString(PSTR("Start prog $"));
@@ -678,11 +723,37 @@ make_pagehandler(tm_startProg_exec, tm_null, 0, 0, OS_PR_START_PROG, prog, peekS
     return true;
 }
 
+#if TM_COMPILE_STACK_SUPPORT
+
+/*!
+ *  This page shows the stack of a process: the bytes it uses right now, the
+ *  most it has ever used (high-water mark) and the size of its stack.
+ *  The high-water mark is searched for only while this page is shown.
+ */
+make_pagehandler(tm_stack, tm_null, 0, 0, OS_PR_STACK_SHOW, pid, peekStack(0).param) {
+    uint16_t const page = peekStack(0).param;
+    if (os_getProcessState(page) == OS_PS_UNUSED) {
+        return false;
+    }
+    lcd_writeProgString(PSTR("Stack #"));
+    lcd_writeDec(page);
+    lcd_writeProgString(PSTR(" u/m/s"));
+    lcd_line2();
+    lcd_writeDec(os_getStackUsage(page));
+    lcd_writeChar('/');
+    lcd_writeDec(os_getStackHighWaterMark(page));
+    lcd_writeChar('/');
+    lcd_writeDec(os_getProcessStackSize(page));
+    return true;
+}
+
+#endif
+
 // XXX slightly ugly
 #define uniqState(state) (((uint32_t)1) << (state))
 
 // procMutator and procMutatorConfirm is only compiled if it is used, thus a warning is avoided
-#if (TM_COMPILE_KILL_SUPPORT||TM_COMPILE_PRIORITY_SUPPORT)
+#if (TM_COMPILE_KILL_SUPPORT||TM_COMPILE_SUSPEND_SUPPORT||TM_COMPILE_PRIORITY_SUPPORT)
 
 /*!
  *  This is a convenience routine, as we have several pages that share the task
@@ -700,7 +771,7 @@ make_pagehandler(tm_startProg_exec, tm_null, 0, 0, OS_PR_START_PROG, prog, peekS
  */
 static bool procMutator(ParamStack const* p, char const* note, uint32_t stateCondition) {
     uint16_t const page = peekStack(0).param;
-    if (!(uniqState(os_getProcessSlot(page)->state) & stateCondition)) {
+    if (!(uniqState(os_getProcessState(page)) & stateCondition)) {
         return false;
     }
     lcd_writeProgString(note);
@@ -710,7 +781,7 @@ static bool procMutator(ParamStack const* p, char const* note, uint32_t stateCon
     lcd_writeDec(os_getNumberOfActiveProcs());
     lcd_line2();
     lcd_writeProgString(PSTR("(of program $"));
-    lcd_writeDec(os_getProcessSlot(page)->progID);
+    lcd_writeDec(os_getProcessProgramID(page));
     lcd_writeChar(')');
     return true;
 }
@@ -757,7 +828,11 @@ static bool procMutatorConfirm(ParamStack const* p, char const* note1, char cons
  *  The page to select a process to kill.
  */
 make_pagehandler(tm_killProc, tm_killProc_kill, 0, 1, OS_PR_KILL_SELECT, pid, peekStack(0).param) {
-    // We can kill a process if it is not unused.
+    // We can kill a process if it is not unused and not part of the OS.
+    uint16_t const page = peekStack(0).param;
+    if (os_getProcessState(page) != OS_PS_UNUSED && tm_isSystemProgram(os_getProcessProgramID(page))) {
+        return false;
+    }
     return procMutator(p, PSTR("Kill"), ~uniqState(OS_PS_UNUSED));
 }
 
@@ -774,7 +849,54 @@ bool internalKill(ProcessID pid){
  *  The page to kill a previously selected process.
  */
 make_pagehandler(tm_killProc_kill, tm_null, 0, 0, OS_PR_KILL, pid, peekStack(1).param) {
-    return procMutatorConfirm(p, PSTR("Killing"), PSTR("Cannot kill #0"), internalKill);
+    ProcessID const proc = peekStack(1).param;
+    procMutatorConfirm(p, PSTR("Killing"), PSTR("Cannot kill #0"), internalKill);
+#if TM_COMPILE_HEAP_SUPPORT
+    // Behind "done", show how much heap memory the process held
+    if (proc && os_getProcessState(proc) == OS_PS_UNUSED) {
+        lcd_writeProgString(PSTR(", heap +"));
+        lcd_writeDec(os_getReclaimedMemory());
+    }
+#else
+    (void)proc;
+#endif
+    return true;
+}
+
+#endif
+
+#if TM_COMPILE_SUSPEND_SUPPORT
+
+/*!
+ *  The page to select a process to suspend or resume.
+ */
+make_pagehandler(tm_suspendProc, tm_suspendProc_toggle, 0, 1, OS_PR_SUSPEND_SELECT, pid, peekStack(0).param) {
+    // We can suspend or resume a process if it is not unused.
+    char const* const note = os_isSuspended(peekStack(0).param) ? PSTR("Resm") : PSTR("Susp");
+    return procMutator(p, note, ~uniqState(OS_PS_UNUSED));
+}
+
+extern ProcessID currentProc;
+
+/*!
+ *  Suspends a running process or resumes a suspended one. Like internalKill,
+ *  this hides the current process, so suspending it does not try to switch
+ *  processes from within the task manager.
+ */
+static bool internalSuspendToggle(ProcessID pid) {
+    ProcessID tmp = currentProc;
+    currentProc = INVALID_PROCESS;
+    bool result = os_isSuspended(pid) ? os_resume(pid) : os_suspend(pid);
+    currentProc = tmp;
+    return result;
+}
+
+/*!
+ *  The page to suspend or resume a previously selected process.
+ */
+make_pagehandler(tm_suspendProc_toggle, tm_null, 0, 0, OS_PR_SUSPEND, pid, peekStack(1).param) {
+    char const* const note = os_isSuspended(peekStack(1).param) ? PSTR("Resuming") : PSTR("Suspending");
+    return procMutatorConfirm(p, note, PSTR("Cannot stop #0"), internalSuspendToggle);
 }
 
 #endif
@@ -817,10 +939,10 @@ static void priorityConstText(uint16_t proc, bool mod) {
 make_pagehandler(tm_priority_show, tm_priority_changeH, 0, 16, OS_PR_PRIORITY_SHOW, pid, peekStack(1).param) {
     uint16_t const proc = peekStack(1).param;
     // Index to start the sub-page with.
-    result->param = os_getProcessSlot(proc)->priority >> 4;
+    result->param = os_getProcessPriority(proc) >> 4;
     priorityConstText(proc, false);
     lcd_writeChar('(');
-    lcd_writeHexByte(os_getProcessSlot(proc)->priority);
+    lcd_writeHexByte(os_getProcessPriority(proc));
     lcd_writeChar(')');
     return true;
 }
@@ -832,12 +954,12 @@ make_pagehandler(tm_priority_show, tm_priority_changeH, 0, 16, OS_PR_PRIORITY_SH
 make_pagehandler(tm_priority_changeH, tm_priority_changeL, 0, 16, OS_PR_PRIORITY, null, 0) {
     uint16_t const proc = peekStack(2).param;
     // Index to start the sub-page with.
-    result->param = os_getProcessSlot(proc)->priority & 0xF;
+    result->param = os_getProcessPriority(proc) & 0xF;
     priorityConstText(proc, true);
     lcd_writeChar('[');
     lcd_writeHexNibble(peekStack(0).param);
     lcd_writeChar(']');
-    lcd_writeHexNibble(os_getProcessSlot(proc)->priority);
+    lcd_writeHexNibble(os_getProcessPriority(proc));
     return true;
 }
 
@@ -863,12 +985,12 @@ make_pagehandler(tm_priority_changeL, tm_priority_set, 0, 1, OS_PR_PRIORITY, nul
  */
 make_pagehandler(tm_priority_set, tm_null, 0, 0, OS_PR_PRIORITY, pid, peekStack(4).param) {
     lcd_writeProgString(PSTR("Setting priority"));
-    os_getProcessSlot(peekStack(4).param)->priority
-        = ((peekStack(2).param & 0xF) << 4)
-          + ((peekStack(1).param & 0xF));
+    os_setProcessPriority(peekStack(4).param,
+        ((peekStack(2).param & 0xF) << 4)
+        + ((peekStack(1).param & 0xF)));
     tm_done();
     lcd_writeProgString(PSTR(", now: "));
-    lcd_writeHexByte(os_getProcessSlot(peekStack(4).param)->priority);
+    lcd_writeHexByte(os_getProcessPriority(peekStack(4).param));
     return true;
 }
 
@@ -1029,7 +1151,7 @@ static char const* getHeapName(uint8_t ram) {
 /*!
  *  The page to select which heap to inspect. Supports NULL-heaps.
  */
-make_pagehandler(tm_heap, tm_heap2, 0, 4, OS_PR_SHOW_HEAP, heapId, peekStack(0).param) {
+make_pagehandler(tm_heap, tm_heap2, 0, 6, OS_PR_SHOW_HEAP, heapId, peekStack(0).param) {
     uint16_t const ram = peekStack(0).param;
     if (ram >= os_getHeapListLength() || !os_lookupHeap(ram)) {
         return false;
@@ -1045,6 +1167,8 @@ static tm_page tm_heap_strategy;
 static tm_page tm_heap_contents;
 static tm_page tm_heap_chunks;
 static tm_page tm_heap_erase;
+static tm_page tm_heap_cache;
+static tm_page tm_heap_compact;
 
 /*!
  *  The page to select what to do with a previously selected heap.
@@ -1053,6 +1177,8 @@ static tm_page tm_heap_erase;
  *   - dump the map
  *   - browse chunks
  *   - erase everything
+ *   - show the hits and misses of the allocation cache
+ *   - show the effect of the compactor
  */
 make_pagehandler(tm_heap2, tm_heap_strategy, 0, MS_MAX_COUNT, OS_PR_ALWAYS_ALLOW, null, 0) {
     Heap* const heap = os_lookupHeap(peekStack(1).param);
@@ -1083,6 +1209,20 @@ make_pagehandler(tm_heap2, tm_heap_strategy, 0, MS_MAX_COUNT, OS_PR_ALWAYS_ALLOW
             result->range = 1;
             break;
         }
+        case 4: {
+            lcd_writeProgString(PSTR("Cache statistics"));
+            result->call = tm_heap_cache;
+            result->param = 0;
+            result->range = MEM_CACHE_CLASS_COUNT;
+            break;
+        }
+        case 5: {
+            lcd_writeProgString(PSTR("Compaction"));
+            result->call = tm_heap_compact;
+            result->param = 0;
+            result->range = 1;
+            break;
+        }
         default:
             return false;
     }
@@ -1095,6 +1235,7 @@ makeStrategyNameLookup(getAllocationStratNames, 0x10, 0,
     {OS_MEM_NEXT,  PSTR("<Next Fit>     ")},
     {OS_MEM_BEST,  PSTR("<Best Fit>     ")},
     {OS_MEM_WORST, PSTR("<Worst Fit>    ")},
+    {OS_MEM_TLSF,  PSTR("<TLSF>         ")},
 )
 
 /*!
@@ -1119,11 +1260,6 @@ make_pagehandler(tm_heap_strategy_set, tm_null, 0, 0, OS_PR_ALLOCATION, as, peek
                            setAS, heap);
 }
 
-static MemValue derefMap(Heap const* heap, MemAddr usePtr) {
-    uint16_t const uOff = usePtr - os_getUseStart(heap);
-    return (heap->driver->read(os_getMapStart(heap) + uOff / 2) >> (((~uOff) & 1) << 2)) & 0xF;
-}
-
 /*!
  *  The page to dump the map entries of the previously selected heap.
  */
@@ -1136,7 +1272,7 @@ make_pagehandler(tm_heap_contents, tm_null, 0, 0, OS_PR_SHOW_HEAP, null, 0) {
         lcd_writeProgString(PSTR(": "));
         for (j = 0; j < 16 - 6; j++)
             if (addr < os_getUseStart(heap) + os_getUseSize(heap)) {
-                lcd_writeHexNibble(derefMap(heap, addr++));
+                lcd_writeHexNibble(os_getMapEntry(heap, addr++));
             } else {
                 i = j = 16;
             }
@@ -1146,14 +1282,13 @@ make_pagehandler(tm_heap_contents, tm_null, 0, 0, OS_PR_SHOW_HEAP, null, 0) {
 
 /*!
  *  The page to display distinct chunks of the heap.
- *  This page will not work correctly with different heap-map specifications
- *  you are free to remove or modify this in case the heap-map semantics are
- *  changed.
+ *  The map entries are provided by os_getMapEntry, which computes them for
+ *  heaps that do not keep a map.
  */
 make_pagehandler(tm_heap_chunks, tm_null, 0, 0, OS_PR_SHOW_HEAP, null, 0) {
     Heap* const heap = os_lookupHeap(peekStack(2).param);
     uint16_t const addr = os_getUseStart(heap) + peekStack(0).param;
-    MemValue const owner = derefMap(heap, addr);
+    MemValue const owner = os_getMapEntry(heap, addr);
     if (owner == 0 || owner == 0xF) {
         return false;
     }
@@ -1165,7 +1300,7 @@ make_pagehandler(tm_heap_chunks, tm_null, 0, 0, OS_PR_SHOW_HEAP, null, 0) {
     lcd_writeChar(')');
     lcd_line2();
     lcd_writeProgString(PSTR("Length: ..."));
-    uint16_t const length = os_getChunkSize(heap, addr);
+    uint16_t const length = os_getChunkSize(heap, os_getFirstByteOfChunk(heap, addr));
     lcd_goto(2, 9);
     lcd_writeProgString(spaces16 + (16 - 3));
     lcd_goto(2, 9);
@@ -1173,6 +1308,40 @@ make_pagehandler(tm_heap_chunks, tm_null, 0, 0, OS_PR_SHOW_HEAP, null, 0) {
     return true;
 }
 
+/*!
+ *  The page to display the allocation cache statistics of one size class of
+ *  the previously selected heap.
+ */
+make_pagehandler(tm_heap_cache, tm_null, 0, 0, OS_PR_SHOW_HEAP, null, 0) {
+    Heap* const heap = os_lookupHeap(peekStack(2).param);
+    uint8_t const cls = peekStack(0).param;
+    lcd_writeDec(os_getCacheClassSize(cls));
+    lcd_writeProgString(PSTR("B hits: "));
+    lcd_writeDec(os_getCacheHits(heap, cls));
+    lcd_line2();
+    lcd_writeProgString(PSTR("miss:"));
+    lcd_writeDec(os_getCacheMisses(heap, cls));
+    lcd_writeProgString(PSTR(" c:"));
+    lcd_writeDec(os_getCachedChunks(heap, cls));
+    return true;
+}
+
+/*!
+ *  The page to display the largest free block of the previously selected
+ *  heap before the compactor last started moving chunks and now.
+ */
+make_pagehandler(tm_heap_compact, tm_null, 0, 0, OS_PR_SHOW_HEAP, null, 0) {
+    Heap* const heap = os_lookupHeap(peekStack(2).param);
+    lcd_writeProgString(PSTR("Max free "));
+    lcd_writeDec(os_getCompactLargestBefore(heap));
+    lcd_line2();
+    lcd_writeProgString(PSTR("now "));
+    lcd_writeDec(os_getLargestFreeBlock(heap));
+    lcd_writeProgString(PSTR(" mv "));
+    lcd_writeDec(os_getCompactMoves(heap));
+    return true;
+}
+
 make_pagehandler(tm_heap_erase, tm_heap_erase2, 0, 1, OS_PR_ERASE_HEAP, heapId, peekStack(2).param) {
     lcd_writeProgString(PSTR("Erase map+dat of"));
     lcd_writeProgString(getHeapName(peekStack(2).param));
@@ -1189,18 +1358,28 @@ make_pagehandler(tm_heap_erase2, tm_null, 0, 0, OS_PR_ERASE_HEAP, heapId, peekSt
     MemAddr end = os_getMapStart(heap) + os_getMapSize(heap);
     MemAddr const mapEnd = end;
     MemAddr ptr;
+    MemValue const zeros[MEM_BLOCK_SIZE] = {0};
     uint8_t lastProgress = 0;
-    for (ptr = start; ptr < end; ptr++) {
-        heap->driver->write(ptr, 0);
+    if (start == end) {
+        // Heaps without a map only erase the use area
+        start = os_getUseStart(heap);
+        end = os_getUseStart(heap) + os_getUseSize(heap);
+    }
+    for (ptr = start; ptr < end;) {
+        // Erase in blocks, so devices like the external SRAM need one transfer per block
+        uint16_t const part = ((uint16_t)(end - ptr) < MEM_BLOCK_SIZE) ? (uint16_t)(end - ptr) : MEM_BLOCK_SIZE;
+        heap->driver->writeBlock(ptr, zeros, part);
+        ptr += part;
         uint8_t progress = (100ul * (uint16_t)(ptr - start)) / (uint16_t)(end - start);
         if (((uint16_t)progress * 32ul) / 100ul != ((uint16_t)lastProgress * 32ul) / 100ul) {
             lcd_drawBar((lastProgress = progress));
         }
-        if (ptr + 1 == mapEnd) {
-            ptr = (start = os_getUseStart(heap)) - 1;
+        if (ptr == mapEnd) {
+            ptr = start = os_getUseStart(heap);
             end = os_getUseStart(heap) + os_getUseSize(heap);
         }
     }
+    os_freeListRebuild(heap);
     tm_done();
     return true;
 }
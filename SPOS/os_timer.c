@@ -0,0 +1,190 @@
+#include "os_timer.h"
+#include "os_deferred.h"
+
+#include <avr/interrupt.h>
+
+/*! \file
+ *
+ * Software timers kept in a delta list. Starting and stopping a timer walks
+ * the list, but the scheduler tick only decrements the head. Expired timers
+ * hand their callback to the deferred work queue, which the scheduler drains
+ * right afterwards. Periodic timers are reinserted relative to their expiry
+ * tick, so they do not drift.
+ *
+ */
+
+//! The active timer that expires next.
+static Timer* os_timerHead;
+
+//! Ticks that passed but could not be applied yet, because the deferred work queue was full
+static uint8_t os_timerTicksCarry;
+
+/*!
+ *  Inserts a timer into the delta list. Must be called with interrupts disabled.
+ *
+ *  \param timer The timer to insert.
+ *  \param delay Ticks until the timer expires (at least 1).
+ */
+static void os_timerInsert(Timer* timer, TimerTicks delay) {
+    Timer* prev = NULL;
+    Timer* curr = os_timerHead;
+
+    while (curr && curr->delta <= delay) {
+        delay -= curr->delta;
+        prev = curr;
+        curr = curr->next;
+    }
+
+    timer->delta = delay;
+    timer->next = curr;
+    timer->active = true;
+    if (curr) {
+        curr->delta -= delay;
+    }
+    if (prev) {
+        prev->next = timer;
+    } else {
+        os_timerHead = timer;
+    }
+}
+
+/*!
+ *  Removes a timer from the delta list. Must be called with interrupts disabled.
+ *
+ *  \param timer The timer to remove.
+ *  \return True if the timer was in the list.
+ */
+static bool os_timerRemove(Timer* timer) {
+    Timer** link = &os_timerHead;
+
+    while (*link && *link != timer) {
+        link = &(*link)->next;
+    }
+    if (!*link) {
+        return false;
+    }
+
+    *link = timer->next;
+    if (timer->next) {
+        timer->next->delta += timer->delta;
+    }
+    timer->active = false;
+    return true;
+}
+
+/*!
+ *  Helper for os_timerStart and os_timerStartOnce.
+ */
+static void os_timerArm(Timer* timer, TimerTicks delay, TimerTicks period, TimerCallback* callback, void* arg) {
+    uint8_t const sreg = SREG;
+    cli();
+
+    if (timer->active) {
+        os_timerRemove(timer);
+    }
+    timer->period = period;
+    timer->callback = callback;
+    timer->arg = arg;
+    if (!delay) {
+        delay = 1;
+    }
+    // Carried ticks passed before the timer was started, so they must not shorten its delay
+    if ((TimerTicks)(delay + os_timerTicksCarry) > delay) {
+        delay += os_timerTicksCarry;
+    }
+    os_timerInsert(timer, delay);
+
+    SREG = sreg;
+}
+
+/*!
+ *  Starts a periodic timer. The callback is first run after one period and
+ *  then every period ticks until the timer is stopped. A running timer is
+ *  restarted.
+ *
+ *  \param timer The timer to start.
+ *  \param period The period in scheduler ticks (see TIMER_MS_TO_TICKS).
+ *  \param callback The function to run on every expiry.
+ *  \param arg The argument passed to the callback.
+ */
+void os_timerStart(Timer* timer, TimerTicks period, TimerCallback* callback, void* arg) {
+    os_timerArm(timer, period, period ? period : 1, callback, arg);
+}
+
+/*!
+ *  Starts a one-shot timer. The callback is run once after the delay. A
+ *  running timer is restarted.
+ *
+ *  \param timer The timer to start.
+ *  \param delay The delay in scheduler ticks (see TIMER_MS_TO_TICKS).
+ *  \param callback The function to run on expiry.
+ *  \param arg The argument passed to the callback.
+ */
+void os_timerStartOnce(Timer* timer, TimerTicks delay, TimerCallback* callback, void* arg) {
+    os_timerArm(timer, delay, 0, callback, arg);
+}
+
+/*!
+ *  Stops a timer. Its callback will not be run anymore, unless it already
+ *  expired and is waiting in the deferred work queue.
+ *
+ *  \param timer The timer to stop.
+ *  \return True if the timer was running.
+ */
+bool os_timerStop(Timer* timer) {
+    uint8_t const sreg = SREG;
+    cli();
+
+    bool const wasActive = timer->active && os_timerRemove(timer);
+
+    SREG = sreg;
+    return wasActive;
+}
+
+/*!
+ *  Checks whether the timer is running.
+ *
+ *  \param timer The timer to examine.
+ *  \return True if the timer will expire.
+ */
+bool os_timerIsActive(Timer const* timer) {
+    return timer->active;
+}
+
+/*!
+ *  Advances the timers by the passed number of ticks. This is called by the
+ *  scheduler ISR with interrupts disabled. Usually this is a single tick, but
+ *  ticks deferred by critical sections are made up for here. Expired timers
+ *  are handed to the deferred work queue. If the queue is full, the timer
+ *  stays at the head of the list and is retried on the next tick. The ticks
+ *  that were not applied yet are carried over to that call, so later timers
+ *  do not drift.
+ *
+ *  \param ticks The number of ticks that passed since the last call.
+ */
+void os_timerTick(uint8_t ticks) {
+    ticks = (ticks > UINT8_MAX - os_timerTicksCarry) ? UINT8_MAX : ticks + os_timerTicksCarry;
+    os_timerTicksCarry = 0;
+
+    while (ticks && os_timerHead) {
+        if (os_timerHead->delta > ticks) {
+            os_timerHead->delta -= ticks;
+            return;
+        }
+        ticks -= os_timerHead->delta;
+        os_timerHead->delta = 0;
+
+        while (os_timerHead && !os_timerHead->delta) {
+            Timer* const timer = os_timerHead;
+            if (!os_deferWork(timer->callback, timer->arg)) {
+                os_timerTicksCarry = ticks;
+                return;
+            }
+            os_timerHead = timer->next;
+            timer->active = false;
+            if (timer->period) {
+                os_timerInsert(timer, timer->period);
+            }
+        }
+    }
+}
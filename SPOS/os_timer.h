@@ -0,0 +1,86 @@
+/*! \file
+ *  \brief Software timers for the OS.
+ *
+ *  Contains one-shot and periodic timers that are driven by the scheduler
+ *  tick. Their callbacks are run as deferred work, so no process and no
+ *  process stack is needed for periodic jobs.
+ */
+
+#ifndef _OS_TIMER_H
+#define _OS_TIMER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "defines.h"
+#include "os_deferred.h"
+
+//----------------------------------------------------------------------------
+// Types
+//----------------------------------------------------------------------------
+
+//! A duration in scheduler ticks.
+typedef uint16_t TimerTicks;
+
+//! This is the type of a timer callback (not the pointer to one!).
+typedef DeferredWork TimerCallback;
+
+/*!
+ *  A software timer. Active timers are kept in a list that is sorted by
+ *  expiry. Each timer only stores the number of ticks after its predecessor
+ *  (delta list), so a tick only has to decrement the head of the list.
+ *  The memory of a timer must stay valid as long as it is active.
+ */
+typedef struct Timer {
+    //! The next timer in the delta list.
+    struct Timer* next;
+
+    //! Ticks between the expiry of the predecessor and this timer.
+    TimerTicks delta;
+
+    //! Ticks between two expiries or 0 for a one-shot timer.
+    TimerTicks period;
+
+    //! The function to run on expiry.
+    TimerCallback* callback;
+
+    //! The argument passed to the callback.
+    void* arg;
+
+    //! Whether the timer is in the list.
+    bool active;
+} Timer;
+
+//----------------------------------------------------------------------------
+// Macros
+//----------------------------------------------------------------------------
+
+/*!
+ *  Frequency of the scheduler tick in Hz. Timer 2 runs with a prescaler of 1024
+ *  and is cleared on a compare match with OCR2A = 60 (see os_init_timer).
+ */
+#define TIMER_TICKS_PER_SECOND      (F_CPU / 1024ul / (60ul + 1ul))
+
+//! Converts milliseconds to scheduler ticks (rounded up)
+#define TIMER_MS_TO_TICKS(ms)       ((TimerTicks)((((uint32_t)(ms)) * TIMER_TICKS_PER_SECOND + 999ul) / 1000ul))
+
+//----------------------------------------------------------------------------
+// Function headers
+//----------------------------------------------------------------------------
+
+//! Starts a periodic timer
+void os_timerStart(Timer* timer, TimerTicks period, TimerCallback* callback, void* arg);
+
+//! Starts a one-shot timer
+void os_timerStartOnce(Timer* timer, TimerTicks delay, TimerCallback* callback, void* arg);
+
+//! Stops a timer
+bool os_timerStop(Timer* timer);
+
+//! Checks whether a timer is running
+bool os_timerIsActive(Timer const* timer);
+
+//! Advances all timers (scheduler only)
+void os_timerTick(uint8_t ticks);
+
+#endif
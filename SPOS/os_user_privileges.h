@@ -17,7 +17,7 @@
 
 #include "os_scheduler.h"
 #include "defines.h"
-#if(VERSUCH >= 3)
+#if HEAP_SUPPORT
     #include "os_memory.h"
 #endif
 
@@ -53,7 +53,10 @@ typedef enum {
     OS_PR_ALLOCATION_SELECT,   //!< Request to show the allocation strategy selection for the previously selected heap.
     OS_PR_ALLOCATION,          //!< Request to set the allocation strategy of the selected heap to the newly chosen.
     OS_PR_SHOW_HEAP,           //!< Request to open the heap sub menu for the selected heap.
-    OS_PR_ERASE_HEAP           //!< Request to completely erase the contents (map and use) of the selected heap.
+    OS_PR_ERASE_HEAP,          //!< Request to completely erase the contents (map and use) of the selected heap.
+    OS_PR_STACK_SHOW,          //!< Request to show the stack usage of the selected process.
+    OS_PR_SUSPEND_SELECT,      //!< Request to show the process suspend/resume selection.
+    OS_PR_SUSPEND              //!< Request to suspend or resume the selected process.
 } PermissionRequest;
 
 //! The argument of the request.
@@ -63,7 +66,7 @@ typedef union {
     ProcessID pid;
     SchedulingStrategy ss;
     uint8_t heapId;
-#if (VERSUCH >= 3)
+#if HEAP_SUPPORT
     AllocStrategy as;
 #else
     uint8_t as;
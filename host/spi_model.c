@@ -0,0 +1,106 @@
+#include "spi_model.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*! \file
+ *
+ * The model sits behind the SPI status register. With interrupts disabled,
+ * os_spiWait polls SPIF, and each poll exchanges the byte written to SPDR
+ * with the model and reports it as complete. The transfer state of os_spi.c
+ * tells when a new transfer starts, so that file is compiled as part of the
+ * model. The critical sections of the scheduler are not needed on the host.
+ *
+ */
+
+#include "os_spi.c"
+#include "os_mem_drivers.c"
+
+volatile uint8_t SREG, SPDR, SPCR, PORTB, DDRB;
+
+uint8_t model_memory[0x10000];
+uint32_t model_busBytes;
+uint32_t model_transfers;
+
+//! The SPI status register as read by the transfer layer
+static uint8_t model_status;
+
+//! Position of the next byte within the running transfer
+static uint16_t model_position;
+
+//! Command of the running transfer
+static uint8_t model_command;
+
+//! The next address the running transfer accesses
+static uint16_t model_address;
+
+//! Whether the device was put into sequential mode
+static bool model_sequential;
+
+/*!
+ *  Stops the test with a message if the drivers violate the protocol.
+ *
+ *  \param ok The condition that has to hold.
+ *  \param what What went wrong.
+ */
+static void model_expect(bool ok, char const* what) {
+    if (!ok) {
+        fprintf(stderr, "spi model: %s (command %02x, byte %u)\n", what, model_command, model_position);
+        exit(1);
+    }
+}
+
+/*!
+ *  Exchanges the byte in SPDR with the device if a transfer is running.
+ *
+ *  \return The SPI status register, SPIF is set if a byte was exchanged.
+ */
+uint8_t* model_poll(void) {
+    model_status = 0;
+    if (!os_spi.busy) {
+        return &model_status;
+    }
+    model_expect(!(PORTB & (1 << SPI_PIN_CS)), "device not selected");
+
+    // Only the first header byte was sent so far
+    if (os_spi.headerPending == os_spi.headerLength && os_spi.headerNext == 1) {
+        model_position = 0;
+        model_transfers++;
+    }
+
+    uint8_t const in = SPDR;
+    uint8_t out = 0;
+    if (model_position == 0) {
+        model_command = in;
+    } else if (model_command == EXT_SRAM_CMD_WRMR) {
+        model_expect(model_position == 1, "mode transfer too long");
+        model_sequential = (in == EXT_SRAM_MODE_SEQUENTIAL);
+    } else if (model_position == 1) {
+        model_expect(in == 0, "address beyond 64 KiB");
+    } else if (model_position == 2) {
+        model_address = (uint16_t)in << 8;
+    } else if (model_position == 3) {
+        model_address |= in;
+    } else {
+        model_expect(model_sequential, "not in sequential mode");
+        if (model_command == EXT_SRAM_CMD_READ) {
+            out = model_memory[model_address++];
+        } else {
+            model_expect(model_command == EXT_SRAM_CMD_WRITE, "unknown command");
+            model_memory[model_address++] = in;
+        }
+    }
+
+    model_position++;
+    model_busBytes++;
+    SPDR = out;
+    model_status = (1 << SPIF);
+    return &model_status;
+}
+
+void os_enterCriticalSection(void) {
+}
+
+void os_leaveCriticalSection(void) {
+}
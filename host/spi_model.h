@@ -0,0 +1,27 @@
+/*! \file
+ *  \brief Host model of the external SPI SRAM (23LC1024).
+ *
+ *  Compiles the SPI transfer layer and the memory drivers of SPOS on the host
+ *  and answers their transfers like the 23LC1024 does in sequential mode.
+ *  The first 64 KiB of the device are modelled, the drivers reach no more.
+ *  Every byte on the bus is counted, so the cost of a driver can be measured.
+ */
+
+#ifndef _SPI_MODEL_H
+#define _SPI_MODEL_H
+
+#include <stdint.h>
+
+#include "os_mem_drivers.h"
+#include "os_spi.h"
+
+//! The contents of the modelled device
+extern uint8_t model_memory[0x10000];
+
+//! Number of bytes exchanged on the bus
+extern uint32_t model_busBytes;
+
+//! Number of transfers, i.e. how often the device was selected
+extern uint32_t model_transfers;
+
+#endif
@@ -0,0 +1,19 @@
+/*! \file
+ *  \brief Host stand-in for the AVR interrupt macros.
+ *
+ *  Interrupt service routines become plain functions, so with interrupts
+ *  never enabled the SPI transfer layer polls the model.
+ */
+
+#ifndef _HOST_AVR_INTERRUPT_H
+#define _HOST_AVR_INTERRUPT_H
+
+#include <avr/io.h>
+
+#define ISR(vector)                     void vector(void); void vector(void)
+#define SPI_STC_vect                    host_spiInterrupt
+
+#define cli()                           (SREG &= ~(1 << SREG_I))
+#define sei()                           (SREG |= (1 << SREG_I))
+
+#endif
@@ -0,0 +1,38 @@
+/*! \file
+ *  \brief Host stand-in for the AVR register definitions.
+ *
+ *  Declares the registers and bits the SPI transfer layer and the memory
+ *  drivers use, so they can be compiled on the host against the SPI model.
+ */
+
+#ifndef _HOST_AVR_IO_H
+#define _HOST_AVR_IO_H
+
+#include <stdint.h>
+
+//! The memories of the ATmega644
+#define RAMSTART                        0x0100
+#define RAMEND                          0x10FF
+#define E2END                           0x07FF
+#define FLASHEND                        0xFFFF
+
+//! The registers, defined by the SPI model
+extern volatile uint8_t SREG, SPDR, SPCR, PORTB, DDRB;
+
+//! The SPI status register, reading it lets the model exchange a byte
+extern uint8_t* model_poll(void);
+#define SPSR                            (*model_poll())
+
+#define SREG_I                          7
+
+#define SPIE                            7
+#define SPE                             6
+#define MSTR                            4
+#define SPIF                            7
+#define SPI2X                           0
+
+#define PB4                             4
+#define PB5                             5
+#define PB7                             7
+
+#endif
@@ -0,0 +1,17 @@
+/*! \file
+ *  \brief Host stand-in for the AVR program memory macros.
+ *
+ *  On the host, program memory is ordinary memory.
+ */
+
+#ifndef _HOST_AVR_PGMSPACE_H
+#define _HOST_AVR_PGMSPACE_H
+
+#include <stdint.h>
+
+#define PROGMEM
+#define PSTR(s)                         (s)
+#define pgm_read_byte(addr)             (*(uint8_t const*)(addr))
+#define pgm_read_word(addr)             (*(uint16_t const*)(addr))
+
+#endif
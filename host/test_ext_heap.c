@@ -0,0 +1,178 @@
+#include "spi_model.h"
+#include "os_memory.h"
+#include "os_memory_strategies.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*! \file
+ *
+ * Runs the heap on the external SRAM driver in both layouts. Processes
+ * allocate, resize and free chunks and handles at random while the compactor
+ * runs now and then. Every live chunk is filled with a pattern that is
+ * checked after each step, so a stale cache line or a wrong transfer shows
+ * up as a corrupted chunk.
+ *
+ */
+
+//! Number of random operations per layout
+#define TEST_ITERATIONS                 20000
+
+//! Maximum number of live chunks
+#define TEST_CHUNKS                     200
+
+//! Maximum number of live handles
+#define TEST_HANDLES                    32
+
+//! A chunk or handle and the pattern it holds
+typedef struct {
+    MemAddr addr;
+    MemHandle handle;
+    uint16_t size;
+    uint8_t seed;
+    ProcessID owner;
+} Block;
+
+static Heap heap;
+static ProcessID current;
+static Block chunks[TEST_CHUNKS];
+static Block handles[TEST_HANDLES];
+static uint16_t chunkCount;
+static uint16_t handleCount;
+
+ProcessID os_getCurrentProc(void) {
+    return current;
+}
+
+void os_errorPStr(char const* str) {
+    printf("os_error: %s\n", str);
+    exit(1);
+}
+
+/*!
+ *  Writes the pattern of a block from the passed offset on.
+ */
+static void fill(MemAddr addr, uint8_t seed, uint16_t from, uint16_t size) {
+    for (uint16_t i = from; i < size; i++) {
+        extSRAM->write(addr + i, (uint8_t)(seed + i));
+    }
+}
+
+/*!
+ *  Checks the pattern of a block and stops the test if it is corrupted.
+ */
+static void check(MemAddr addr, uint8_t seed, uint16_t size, int iteration) {
+    for (uint16_t i = 0; i < size; i++) {
+        if (extSRAM->read(addr + i) != (uint8_t)(seed + i)) {
+            printf("layout %d: chunk %u corrupted in iteration %d\n", heap.layout, addr, iteration);
+            exit(1);
+        }
+    }
+}
+
+/*!
+ *  Runs the random operations on a heap with the passed layout.
+ */
+static void run(MemLayout layout) {
+    heap = (Heap){ .driver = extSRAM, .layout = layout };
+    if (layout == OS_MEM_LAYOUT_TAGS) {
+        heap.mapStart = heap.useStart = 600;
+        heap.useSize = 3000;
+    } else {
+        heap.mapStart = 100;
+        heap.mapSize = 1000;
+        heap.useStart = 1100;
+        heap.useSize = 2000;
+        MemValue const zeros[1000] = {0};
+        extSRAM->writeBlock(heap.mapStart, zeros, heap.mapSize);
+    }
+    os_freeListRebuild(&heap);
+    chunkCount = handleCount = 0;
+
+    uint32_t failed = 0;
+    for (int it = 0; it < TEST_ITERATIONS; it++) {
+        if (it % 997 == 0) {
+            os_setAllocationStrategy(&heap, rand() % 5);
+        }
+
+        if (chunkCount < TEST_CHUNKS && (rand() % 2 || !chunkCount)) {
+            current = 1 + rand() % 7;
+            uint16_t const size = 1 + ((rand() % 4) ? rand() % 20 : rand() % 200);
+            MemAddr const addr = os_malloc(&heap, size);
+            if (addr) {
+                chunks[chunkCount++] = (Block){ .addr = addr, .size = size, .seed = it, .owner = current };
+                fill(addr, it, 0, size);
+            } else {
+                failed++;
+            }
+        } else {
+            uint16_t const i = rand() % chunkCount;
+            current = chunks[i].owner;
+            os_free(&heap, chunks[i].addr);
+            chunks[i] = chunks[--chunkCount];
+        }
+
+        if (chunkCount && rand() % 4 == 0) {
+            Block* const chunk = &chunks[rand() % chunkCount];
+            uint16_t const size = 1 + rand() % 150;
+            current = chunk->owner;
+            MemAddr const addr = os_realloc(&heap, chunk->addr, size);
+            if (addr) {
+                check(addr, chunk->seed, (size < chunk->size) ? size : chunk->size, it);
+                fill(addr, chunk->seed, chunk->size, size);
+                chunk->addr = addr;
+                chunk->size = size;
+            }
+        }
+
+        switch (rand() % 9) {
+            case 0:
+                if (handleCount < TEST_HANDLES) {
+                    current = 1 + rand() % 7;
+                    uint16_t const size = 1 + rand() % 60;
+                    MemHandle const handle = os_hmalloc(&heap, size);
+                    if (handle) {
+                        fill(os_hlock(&heap, handle), it, 0, size);
+                        os_hunlock(&heap, handle);
+                        handles[handleCount++] = (Block){ .handle = handle, .size = size, .seed = it, .owner = current };
+                    }
+                }
+                break;
+            case 1:
+                if (handleCount) {
+                    uint16_t const i = rand() % handleCount;
+                    current = handles[i].owner;
+                    os_hfree(&heap, handles[i].handle);
+                    handles[i] = handles[--handleCount];
+                }
+                break;
+            case 2:
+                for (uint8_t step = 0; step < 5; step++) {
+                    os_compactStep(&heap);
+                }
+                break;
+        }
+
+        for (uint16_t i = 0; i < chunkCount; i++) {
+            check(chunks[i].addr, chunks[i].seed, chunks[i].size, it);
+        }
+        for (uint16_t i = 0; i < handleCount; i++) {
+            current = handles[i].owner;
+            check(os_hlock(&heap, handles[i].handle), handles[i].seed, handles[i].size, it);
+            os_hunlock(&heap, handles[i].handle);
+        }
+    }
+
+    printf("ok: layout %d, %lu failed allocations, %u chunks moved by the compactor\n",
+           layout, (unsigned long)failed, os_getCompactMoves(&heap));
+}
+
+int main(void) {
+    srand(2);
+    os_spiInit();
+    extSRAM->init();
+    run(OS_MEM_LAYOUT_MAP);
+    run(OS_MEM_LAYOUT_TAGS);
+    printf("%lu bytes on the bus in %lu transfers\n", (unsigned long)model_busBytes, (unsigned long)model_transfers);
+    return 0;
+}
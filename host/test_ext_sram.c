@@ -0,0 +1,91 @@
+#include "spi_model.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*! \file
+ *
+ * Checks the external SRAM driver against a shadow copy. Random byte and
+ * block accesses, half of them within a few pages so the cache is hit, are
+ * compared to the shadow. Finally all dirty pages are evicted and the device
+ * itself has to match the shadow. The bytes on the bus are reported next to
+ * what byte-wise transfers (command, three address bytes and the data byte)
+ * would have cost.
+ *
+ */
+
+//! Number of random accesses
+#define TEST_ITERATIONS                 400000UL
+
+//! Largest block accessed at once
+#define TEST_BLOCK_MAX                  100
+
+//! What the device should contain
+static uint8_t shadow[0x10000];
+
+int main(void) {
+    srand(5);
+    os_spiInit();
+    extSRAM->init();
+
+    uint32_t accessed = 0;
+    for (uint32_t i = 0; i < TEST_ITERATIONS; i++) {
+        MemAddr addr = rand() % EXT_SRAM_SIZE;
+        if (rand() % 2) {
+            addr %= 600;
+        }
+        uint16_t length = 1 + rand() % TEST_BLOCK_MAX;
+        if (addr + length > EXT_SRAM_SIZE) {
+            length = EXT_SRAM_SIZE - addr;
+        }
+
+        MemValue buffer[TEST_BLOCK_MAX];
+        switch (rand() % 6) {
+            case 0:
+                shadow[addr] = rand();
+                extSRAM->write(addr, shadow[addr]);
+                accessed++;
+                break;
+            case 1:
+            case 2:
+                if (extSRAM->read(addr) != shadow[addr]) {
+                    printf("read %u differs\n", addr);
+                    return 1;
+                }
+                accessed++;
+                break;
+            case 3:
+                for (uint16_t j = 0; j < length; j++) {
+                    buffer[j] = shadow[addr + j] = rand();
+                }
+                extSRAM->writeBlock(addr, buffer, length);
+                accessed += length;
+                break;
+            default:
+                extSRAM->readBlock(addr, buffer, length);
+                for (uint16_t j = 0; j < length; j++) {
+                    if (buffer[j] != shadow[addr + j]) {
+                        printf("block read %u differs\n", addr + j);
+                        return 1;
+                    }
+                }
+                accessed += length;
+                break;
+        }
+    }
+
+    // Pages far away from the accessed ones evict every cache line
+    for (uint8_t line = 0; line < EXT_SRAM_CACHE_LINES; line++) {
+        extSRAM->read(0x8000 + line * EXT_SRAM_PAGE_SIZE);
+    }
+    for (uint32_t addr = 0; addr < EXT_SRAM_SIZE; addr++) {
+        if (model_memory[addr] != shadow[addr]) {
+            printf("device byte %lu differs\n", (unsigned long)addr);
+            return 1;
+        }
+    }
+
+    printf("ok: %lu bytes on the bus in %lu transfers, byte-wise would be %lu bytes\n",
+           (unsigned long)model_busBytes, (unsigned long)model_transfers, (unsigned long)accessed * 5);
+    return 0;
+}